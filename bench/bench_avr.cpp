@@ -0,0 +1,65 @@
+/*
+On-target runner of the sta microbenchmarks (env:bench_nanoatmega328).
+
+Links every kernel into the firmware, so scripts/avr_insn_count.py can count the
+instructions of each one statically from the ELF. When the firmware runs, on a board
+or under simavr, every kernel is also timed in CPU cycles with Timer1 and the table is
+printed on Serial at 115200 baud.
+*/
+
+#ifndef ARDUINO_ARCH_HOST
+
+#include "kernels.h"
+
+// Operations per measurement, small enough to keep vector growth inside 2KB of SRAM
+#define BENCH_OPS 32
+
+#if defined(ARDUINO_ARCH_AVR) && defined(TCNT1)
+static volatile unsigned long bench_overflows;
+
+ISR(TIMER1_OVF_vect) {
+	bench_overflows++;
+}
+
+static unsigned long bench_cycles(bench_fn fn, unsigned long n) {
+	TCCR1A = 0;
+	TCCR1B = 0;
+	TCNT1 = 0;
+	bench_overflows = 0;
+	TIFR1 = _BV(TOV1);
+	TIMSK1 = _BV(TOIE1);
+	TCCR1B = _BV(CS10); // no prescaler, one tick per cycle
+
+	bench_sink = fn(n);
+
+	TCCR1B = 0;
+	TIMSK1 = 0;
+	unsigned long ticks = TCNT1;
+	if (TIFR1 & _BV(TOV1)) bench_overflows++;
+	return (bench_overflows << 16) | ticks;
+}
+#else
+static unsigned long bench_cycles(bench_fn fn, unsigned long n) {
+	unsigned long start = micros();
+	bench_sink = fn(n);
+	return (micros() - start) * (F_CPU / 1000000UL);
+}
+#endif
+
+void setup() {
+	Serial.begin(115200);
+	Serial.println(F("kernel,cycles_per_op"));
+	for (unsigned i = 0; i < bench_kernel_count; i++) {
+		// subtract the cost of calling a kernel with no work
+		unsigned long base = bench_cycles(bench_kernels[i].fn, 0);
+		unsigned long cycles = bench_cycles(bench_kernels[i].fn, BENCH_OPS);
+		Serial.print(bench_kernels[i].name);
+		Serial.print(',');
+		Serial.println((cycles - base) / BENCH_OPS);
+	}
+	Serial.println(F("done"));
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+Host runner of the sta microbenchmarks (env:bench).
+
+Every kernel is calibrated until one batch takes at least --min-ms of wall time and is
+then measured over --repeat batches, keeping the fastest. Heap traffic is counted by
+replacing the global operator new/delete.
+
+	pio run -e bench && .pio/build/bench/program [--csv] [--min-ms N] [--repeat N] [filter]
+*/
+
+#ifdef ARDUINO_ARCH_HOST
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+
+namespace {
+
+unsigned long long g_allocs = 0;
+unsigned long long g_alloc_bytes = 0;
+
+struct bench_result {
+	double nsPerOp;
+	double allocsPerOp;
+	double bytesPerOp;
+};
+
+unsigned long long now_ns() {
+	return (unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bench_result run(const bench_kernel& kernel, unsigned long long minNs, int repeat) {
+	unsigned long n = 1;
+	for (;;) {
+		unsigned long long start = now_ns();
+		bench_sink = kernel.fn(n);
+		if (now_ns() - start >= minNs || n >= (1UL << 24)) break;
+		n *= 2;
+	}
+
+	bench_result best = { 1e300, 0, 0 };
+	for (int r = 0; r < repeat; r++) {
+		unsigned long long allocs = g_allocs, bytes = g_alloc_bytes;
+		unsigned long long start = now_ns();
+		bench_sink = kernel.fn(n);
+		unsigned long long elapsed = now_ns() - start;
+
+		double ns = (double) elapsed / (double) n;
+		if (ns < best.nsPerOp) {
+			best.nsPerOp = ns;
+			best.allocsPerOp = (double) (g_allocs - allocs) / (double) n;
+			best.bytesPerOp = (double) (g_alloc_bytes - bytes) / (double) n;
+		}
+	}
+	return best;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+	g_allocs++;
+	g_alloc_bytes += size;
+	void* p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	g_allocs++;
+	g_alloc_bytes += size;
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+	return operator new(size, tag);
+}
+
+#if __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+	g_allocs++;
+	g_alloc_bytes += size;
+	void* p = nullptr;
+	size_t a = (size_t) align < sizeof(void*) ? sizeof(void*) : (size_t) align;
+	return posix_memalign(&p, a, size ? size : 1) ? nullptr : p;
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+	void* p = operator new(size, align, std::nothrow);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+	return operator new(size, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t& tag) noexcept {
+	return operator new(size, align, tag);
+}
+#endif
+
+// Every form frees through release(), kept out of line so the compiler does not pair
+// the malloc inside new with a free inlined into the caller's delete
+__attribute__((noinline)) static void release(void* p) noexcept { free(p); }
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+
+#if __cpp_aligned_new
+void operator delete(void* p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+#endif
+
+int main(int argc, char** argv) {
+	bool csv = false;
+	double minMs = 50;
+	int repeat = 5;
+	const char* filter = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--csv")) csv = true;
+		else if (!strcmp(argv[i], "--min-ms") && i + 1 < argc) minMs = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = atoi(argv[++i]);
+		else filter = argv[i];
+	}
+
+	if (csv) printf("kernel,ns_per_op,allocs_per_op,bytes_per_op\n");
+	else printf("%-20s %12s %12s %12s\n", "kernel", "ns/op", "allocs/op", "bytes/op");
+
+	for (unsigned i = 0; i < bench_kernel_count; i++) {
+		const bench_kernel& kernel = bench_kernels[i];
+		if (filter && !strstr(kernel.name, filter)) continue;
+
+		bench_result r = run(kernel, (unsigned long long) (minMs * 1e6), repeat);
+		if (csv) printf("%s,%.3f,%.4f,%.2f\n", kernel.name, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+		else printf("%-20s %12.3f %12.4f %12.2f\n", kernel.name, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,263 @@
+#ifndef _STA_BENCH_KERNELS_
+#define _STA_BENCH_KERNELS_
+
+/*
+Benchmark kernels for the hot primitives of sta core/ and types/.
+
+Every kernel runs 'n' operations and returns a checksum so the optimizer cannot drop
+the work. They are extern "C" and never inlined, which gives them stable symbol names:
+the host runner (bench_host.cpp) times them, and on AVR the same symbols are counted
+instruction by instruction in the firmware (scripts/avr_insn_count.py) or timed in
+cycles with Timer1 (bench_avr.cpp).
+
+To add a kernel: write a STA_BENCH_KERNEL function and list it in bench_kernels[].
+*/
+
+#include <Arduino.h>
+
+#include "sta.h"
+#include "core/containers.h"
+#include "core/functional.h"
+#include "core/memory.h"
+#include "core/periodic.h"
+#include "core/timer_wheel.h"
+#include "types/fixed.h"
+
+#define STA_BENCH_KERNEL extern "C" __attribute__((noinline, used)) unsigned long
+
+typedef unsigned long (*bench_fn)(unsigned long n);
+
+struct bench_kernel {
+	const char* name;
+	bench_fn fn;
+};
+
+// Keeps values alive across kernels without letting the compiler see through them
+static volatile unsigned long bench_sink;
+
+// Forces 'value' to be materialized on every iteration, so loops are not folded into closed forms
+template <typename T>
+inline void bench_keep(T& value) {
+	__asm__ __volatile__("" : : "g"(&value) : "memory");
+}
+
+// CONTAINERS
+
+STA_BENCH_KERNEL bench_vector_push(unsigned long n) {
+	sta::vector<int> v;
+	for (unsigned long i = 0; i < n; i++) {
+		int value = (int) i;
+		v.push(value);
+	}
+	return v.size();
+}
+
+STA_BENCH_KERNEL bench_vector_push_pop(unsigned long n) {
+	sta::vector<int> v(8);
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++) {
+		v.push((int) i);
+		sum += v.pop();
+	}
+	return sum;
+}
+
+STA_BENCH_KERNEL bench_vector_get(unsigned long n) {
+	static sta::vector<int> v(16);
+	if (v.empty())
+		for (int i = 0; i < 16; i++) v.push(i);
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++)
+		sum += v.get(i & 15);
+	return sum;
+}
+
+STA_BENCH_KERNEL bench_array_fill(unsigned long n) {
+	sta::array<int, 16> a;
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++) {
+		a.fill((int) i);
+		sum += a[i & 15];
+	}
+	return sum;
+}
+
+STA_BENCH_KERNEL bench_ring_push_pop(unsigned long n) {
+	static sta::ring_buffer<uint8_t, 16> r;
+	unsigned long sum = 0;
+	uint8_t out;
+	for (unsigned long i = 0; i < n; i++) {
+		r.push((uint8_t) i);
+		if (r.pop(out)) sum += out;
+	}
+	return sum;
+}
+
+// FUNCTIONAL
+
+STA_BENCH_KERNEL bench_function_call(unsigned long n) {
+	static sta::function<int(int)> f = [](int a) { return a + 1; };
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++)
+		sum += f((int) i);
+	return sum;
+}
+
+STA_BENCH_KERNEL bench_function_construct(unsigned long n) {
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++) {
+		sta::function<int(int)> f = [](int a) { return a * 2; };
+		sum += f((int) i);
+	}
+	return sum;
+}
+
+STA_BENCH_KERNEL bench_function_assign(unsigned long n) {
+	static sta::function<int(int)> f = [](int a) { return a; };
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++) {
+		f = [](int a) { return a + 2; };
+		sum += f((int) i);
+	}
+	return sum;
+}
+
+static unsigned long bench_call_ref(sta::function_ref<int(int)> f, unsigned long n) {
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++)
+		sum += f((int) i);
+	return sum;
+}
+
+STA_BENCH_KERNEL bench_function_ref_call(unsigned long n) {
+	int offset = (int) bench_sink;
+	return bench_call_ref([offset](int a) { return a + offset; }, n);
+}
+
+// MEMORY
+
+STA_BENCH_KERNEL bench_unique_ptr(unsigned long n) {
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++) {
+		sta::unique_ptr<long> p = sta::make_unique<long>((long) i);
+		sum += (unsigned long) *p;
+	}
+	return sum;
+}
+
+STA_BENCH_KERNEL bench_block_pool(unsigned long n) {
+	static sta::block_pool<sizeof(long), 4> pool;
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++) {
+		sta::unique_ptr<long, sta::pool_delete<long, decltype(pool)>> p = sta::allocate_unique<long>(pool, (long) i);
+		sum += (unsigned long) *p;
+	}
+	return sum;
+}
+
+// TIMERS
+
+static void bench_count_expired(void* context) {
+	(*static_cast<unsigned long*>(context))++;
+}
+
+STA_BENCH_KERNEL bench_timer_wheel(unsigned long n) {
+	static sta::timer_wheel wheel;
+	static sta::timer_entry entries[8];
+	static uint32_t now = 0;
+	unsigned long fired = 0;
+	for (unsigned long i = 0; i < n; i++) {
+		sta::timer_entry& entry = entries[i & 7];
+		entry.bind(&bench_count_expired, &fired);
+		wheel.schedule(entry, now + 1 + (uint32_t) (i & 63));
+		wheel.update(++now);
+	}
+	return fired;
+}
+
+// FIXED POINT
+
+STA_BENCH_KERNEL bench_fixed16_mul(unsigned long n) {
+	sta::fp16_16 acc(1.0);
+	sta::fp16_16 k(1.0001);
+	for (unsigned long i = 0; i < n; i++)
+		acc = acc * k;
+	return (unsigned long) acc.get();
+}
+
+STA_BENCH_KERNEL bench_fixed16_div(unsigned long n) {
+	sta::fp16_16 acc(1000.0);
+	sta::fp16_16 k(1.0001);
+	for (unsigned long i = 0; i < n; i++)
+		acc = acc / k;
+	return (unsigned long) acc.get();
+}
+
+STA_BENCH_KERNEL bench_fixed16_add(unsigned long n) {
+	sta::fp16_16 acc(0.0);
+	sta::fp16_16 k(0.5);
+	for (unsigned long i = 0; i < n; i++) {
+		acc += k;
+		bench_keep(acc);
+	}
+	return (unsigned long) acc.get();
+}
+
+STA_BENCH_KERNEL bench_fixed8_mul(unsigned long n) {
+	sta::fp8_8 acc(1.0);
+	sta::fp8_8 k(1.01);
+	for (unsigned long i = 0; i < n; i++) {
+		acc = acc * k;
+		if (acc.get() > 0x4000) acc = sta::fp8_8(1.0);
+	}
+	return (unsigned long) acc.get();
+}
+
+// PERIODIC
+
+STA_BENCH_KERNEL bench_circ_add(unsigned long n) {
+	int angle = 0;
+	for (unsigned long i = 0; i < n; i++)
+		angle = sta::circ_add(angle, (int) (i & 511));
+	return (unsigned long) angle;
+}
+
+STA_BENCH_KERNEL bench_circ_sub(unsigned long n) {
+	int angle = 0;
+	for (unsigned long i = 0; i < n; i++)
+		angle = sta::circ_sub(angle, (int) (i & 511));
+	return (unsigned long) angle;
+}
+
+STA_BENCH_KERNEL bench_circ_sdist(unsigned long n) {
+	unsigned long sum = 0;
+	for (unsigned long i = 0; i < n; i++)
+		sum += sta::circ_sdist((int) (i % 360), (int) ((i * 7) % 360));
+	return sum;
+}
+
+static const bench_kernel bench_kernels[] = {
+	{ "vector_push",        bench_vector_push },
+	{ "vector_push_pop",    bench_vector_push_pop },
+	{ "vector_get",         bench_vector_get },
+	{ "array_fill",         bench_array_fill },
+	{ "ring_push_pop",      bench_ring_push_pop },
+	{ "function_call",      bench_function_call },
+	{ "function_construct", bench_function_construct },
+	{ "function_assign",    bench_function_assign },
+	{ "function_ref_call",  bench_function_ref_call },
+	{ "unique_ptr",         bench_unique_ptr },
+	{ "block_pool",         bench_block_pool },
+	{ "timer_wheel",        bench_timer_wheel },
+	{ "fixed16_mul",        bench_fixed16_mul },
+	{ "fixed16_div",        bench_fixed16_div },
+	{ "fixed16_add",        bench_fixed16_add },
+	{ "fixed8_mul",         bench_fixed8_mul },
+	{ "circ_add",           bench_circ_add },
+	{ "circ_sub",           bench_circ_sub },
+	{ "circ_sdist",         bench_circ_sdist },
+};
+
+static const unsigned bench_kernel_count = sizeof(bench_kernels) / sizeof(bench_kernels[0]);
+
+#endif
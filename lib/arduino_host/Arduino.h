@@ -0,0 +1,110 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/*
+Host (Linux) stand-in for the Arduino core.
+
+Provides the subset of the Arduino API used by sta on top of a virtual clock and a
+virtual pin bank, see arduino_host.h for the controls. Every standard header used by
+the stub is pulled in first since the core's min/max macros below would otherwise break
+them; host code that needs more of the standard library must include it before Arduino.h.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "binary.h"
+#include "WString.h"
+#include "Print.h"
+#include "HardwareSerial.h"
+#include "arduino_host.h"
+
+#ifndef ARDUINO_ARCH_HOST
+#define ARDUINO_ARCH_HOST
+#endif
+
+// The host <math.h> already declares the ISO C++ float/long double overloads
+#ifndef __CORRECT_ISO_CPP_MATH_H_PROTO
+#define __CORRECT_ISO_CPP_MATH_H_PROTO
+#endif
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define LED_BUILTIN 13
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define sq(x) ((x)*(x))
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitToggle(value, bit) ((value) ^= (1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*) (addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(const uint16_t*) (addr))
+
+#define interrupts() ((void) 0)
+#define noInterrupts() ((void) 0)
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef unsigned int word;
+
+// TIME
+// The counters are 64-bit on the host but wrap at 32 bits exactly like on the board.
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// DIGITAL AND ANALOG I/O
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// SKETCH
+void setup(void);
+void loop(void);
+
+#endif
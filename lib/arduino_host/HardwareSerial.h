@@ -0,0 +1,66 @@
+#ifndef _ARDUINO_HOST_HARDWARE_SERIAL_
+#define _ARDUINO_HOST_HARDWARE_SERIAL_
+
+#include <deque>
+#include <string>
+#include "Print.h"
+#include "SerialCapture.h"
+
+/*
+Host model of a UART.
+
+Transmission goes through a 64 byte TX buffer that drains at the configured baud rate
+in virtual time, so availableForWrite() and a blocking write() behave like on the board.
+Everything that leaves the wire is optionally echoed to stdout, and its last bytes are
+kept in sent() (see SerialCapture.h for the limit).
+Received bytes are injected with inject().
+*/
+class HardwareSerial : public Stream {
+public:
+	static const int TxBufferSize = 64;
+public:
+	explicit HardwareSerial(bool echo = false)
+		: _baud(0), _echo(echo), _txQueued(0), _lastDrainUs(0) {}
+public:
+	void begin(unsigned long baud) { _baud = baud; }
+	void begin(unsigned long baud, uint8_t) { begin(baud); }
+	void end() { flush(); _baud = 0; }
+	operator bool() const { return true; }
+
+	int available() override { return (int) _rx.size(); }
+	int peek() override { return _rx.empty() ? -1 : _rx.front(); }
+	int read() override {
+		if (_rx.empty()) return -1;
+		int c = _rx.front();
+		_rx.pop_front();
+		return c;
+	}
+
+	int availableForWrite() override;
+	void flush() override;
+	size_t write(uint8_t c) override;
+	using Print::write;
+public: // HOST ONLY
+	void inject(const uint8_t* data, size_t size) { _rx.insert(_rx.end(), data, data + size); }
+	void inject(const char* str) { inject((const uint8_t*) str, strlen(str)); }
+	void setEcho(bool echo) { _echo = echo; }
+	std::string& sent() { return _sent.str(); }
+	void clearSent() { _sent.clear(); }
+	// Bytes sent() keeps at most, 0 stops capturing
+	void setCapture(size_t limit) { _sent.setLimit(limit); }
+	unsigned long baud() const { return _baud; }
+private:
+	void drain();
+	uint64_t byteTimeUs() const { return _baud ? 10000000ULL / _baud : 0; }
+private:
+	unsigned long _baud;
+	bool _echo;
+	int _txQueued;
+	uint64_t _lastDrainUs;
+	std::deque<uint8_t> _rx;
+	SerialCapture _sent;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _ARDUINO_HOST_PRINT_
+#define _ARDUINO_HOST_PRINT_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+/*
+Print/Stream stand-ins with the same overload set as the Arduino core.
+Derived classes only implement write(uint8_t) and the Stream primitives.
+*/
+class Print {
+public:
+	virtual ~Print() {}
+
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size) {
+		size_t n = 0;
+		while (size--) n += write(*buffer++);
+		return n;
+	}
+	size_t write(const char* str) { return str ? write((const uint8_t*) str, strlen(str)) : 0; }
+	size_t write(const char* buffer, size_t size) { return write((const uint8_t*) buffer, size); }
+	virtual int availableForWrite() { return 0; }
+	virtual void flush() {}
+public:
+	size_t print(const __FlashStringHelper* f) { return write(reinterpret_cast<const char*>(f)); }
+	size_t print(const String& s) { return write(s.c_str(), s.length()); }
+	size_t print(const char* str) { return write(str); }
+	size_t print(char c) { return write((uint8_t) c); }
+	size_t print(unsigned char n, int base = DEC) { return print(String(n, (unsigned char) base)); }
+	size_t print(int n, int base = DEC) { return print(String(n, (unsigned char) base)); }
+	size_t print(unsigned int n, int base = DEC) { return print(String(n, (unsigned char) base)); }
+	size_t print(long n, int base = DEC) { return print(String(n, (unsigned char) base)); }
+	size_t print(unsigned long n, int base = DEC) { return print(String(n, (unsigned char) base)); }
+	size_t print(long long n, int base = DEC) { return print(String(n, (unsigned char) base)); }
+	size_t print(unsigned long long n, int base = DEC) { return print(String(n, (unsigned char) base)); }
+	size_t print(double n, int digits = 2) { return print(String(n, (unsigned char) digits)); }
+
+	size_t println() { return write("\r\n"); }
+	template <typename T>
+	size_t println(const T& t) { size_t n = print(t); return n + println(); }
+	template <typename T>
+	size_t println(const T& t, int format) { size_t n = print(t, format); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+	Stream() : _timeout(1000) {}
+
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+public:
+	void setTimeout(unsigned long timeout) { _timeout = timeout; }
+	unsigned long getTimeout() const { return _timeout; }
+
+	// Reads until 'length' bytes arrived or the timeout elapsed, like the Arduino core.
+	// Implemented by the host stub so that waiting consumes virtual time.
+	size_t readBytes(char* buffer, size_t length);
+	size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*) buffer, length); }
+	String readString();
+protected:
+	int timedRead();
+	unsigned long _timeout;
+};
+
+#endif
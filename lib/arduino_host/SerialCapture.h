@@ -0,0 +1,43 @@
+#ifndef _ARDUINO_HOST_SERIAL_CAPTURE_
+#define _ARDUINO_HOST_SERIAL_CAPTURE_
+
+#include <stddef.h>
+#include <string>
+
+/*
+What a host serial port sent, for tests and tools to inspect.
+
+Only the last limit() bytes are kept, so a long simulation does not grow it without
+bound; a limit of 0 turns capturing off. Trimming happens in batches, keeping a
+written byte O(1).
+*/
+class SerialCapture {
+public:
+	static const size_t DefaultLimit = 65536;
+public:
+	SerialCapture() : _limit(DefaultLimit) {}
+public:
+	void push(char c) {
+		if (_limit == 0) return;
+		_data.push_back(c);
+		if (_data.size() >= 2 * _limit) trim();
+	}
+
+	std::string& str() {
+		trim();
+		return _data;
+	}
+
+	void clear() { _data.clear(); }
+	void setLimit(size_t limit) { _limit = limit; trim(); }
+	size_t limit() const { return _limit; }
+private:
+	void trim() {
+		if (_data.size() > _limit) _data.erase(0, _data.size() - _limit);
+	}
+private:
+	size_t _limit;
+	std::string _data;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _ARDUINO_HOST_SOFTWARE_SERIAL_
+#define _ARDUINO_HOST_SOFTWARE_SERIAL_
+
+#include <deque>
+#include <functional>
+#include <string>
+#include "Print.h"
+#include "SerialCapture.h"
+
+/*
+Host model of SoftwareSerial.
+
+Like the real library, transmission is bit-banged: every byte written blocks the caller
+for 10 bit times of virtual time. A responder callback can be installed to emulate the
+device on the other end (e.g. a Nextion display answering commands). The last bytes
+written are kept in sent(), like on HardwareSerial.
+*/
+class SoftwareSerial : public Stream {
+public:
+	typedef std::function<void(SoftwareSerial&, uint8_t)> responder;
+public:
+	SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic = false)
+		: _rxPin(receivePin), _txPin(transmitPin), _baud(0) { (void) inverse_logic; }
+public:
+	void begin(long speed) { _baud = speed; }
+	void end() { _baud = 0; }
+	bool listen() { return true; }
+	bool isListening() { return true; }
+	bool overflow() { return false; }
+
+	int available() override { return (int) _rx.size(); }
+	int peek() override { return _rx.empty() ? -1 : _rx.front(); }
+	int read() override {
+		if (_rx.empty()) return -1;
+		int c = _rx.front();
+		_rx.pop_front();
+		return c;
+	}
+
+	size_t write(uint8_t c) override;
+	using Print::write;
+	operator bool() { return true; }
+public: // HOST ONLY
+	void inject(const uint8_t* data, size_t size) { _rx.insert(_rx.end(), data, data + size); }
+	void inject(const char* str) { inject((const uint8_t*) str, strlen(str)); }
+	void setResponder(responder r) { _responder = r; }
+	std::string& sent() { return _sent.str(); }
+	void clearSent() { _sent.clear(); }
+	// Bytes sent() keeps at most, 0 stops capturing
+	void setCapture(size_t limit) { _sent.setLimit(limit); }
+private:
+	uint8_t _rxPin, _txPin;
+	long _baud;
+	std::deque<uint8_t> _rx;
+	SerialCapture _sent;
+	responder _responder;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef _ARDUINO_HOST_WSTRING_
+#define _ARDUINO_HOST_WSTRING_
+
+#include <string>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+/*
+Arduino String stand-in backed by std::string.
+Only the part of the WString API used by sta and typical sketches is provided.
+*/
+class String {
+public:
+	String(const char* cstr = "") : _s(cstr ? cstr : "") {}
+	String(const std::string& s) : _s(s) {}
+	String(const __FlashStringHelper* f) : _s(reinterpret_cast<const char*>(f)) {}
+	explicit String(char c) : _s(1, c) {}
+	explicit String(unsigned char value, unsigned char base = DEC) { fromUnsigned(value, base); }
+	explicit String(int value, unsigned char base = DEC) { fromSigned(value, base); }
+	explicit String(unsigned int value, unsigned char base = DEC) { fromUnsigned(value, base); }
+	explicit String(long value, unsigned char base = DEC) { fromSigned(value, base); }
+	explicit String(unsigned long value, unsigned char base = DEC) { fromUnsigned(value, base); }
+	explicit String(long long value, unsigned char base = DEC) { fromSigned(value, base); }
+	explicit String(unsigned long long value, unsigned char base = DEC) { fromUnsigned(value, base); }
+	explicit String(float value, unsigned char decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+	explicit String(double value, unsigned char decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+public:
+	unsigned int length() const { return (unsigned int) _s.length(); }
+	const char* c_str() const { return _s.c_str(); }
+	bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+	char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+	char operator[](unsigned int index) const { return charAt(index); }
+	char& operator[](unsigned int index) { return _s[index]; }
+
+	String substring(unsigned int from) const { return substring(from, length()); }
+	String substring(unsigned int from, unsigned int to) const {
+		if (from > to) { unsigned int t = from; from = to; to = t; }
+		if (from >= _s.length()) return String();
+		return String(_s.substr(from, to - from));
+	}
+
+	int indexOf(char c) const { size_t i = _s.find(c); return i == std::string::npos ? -1 : (int) i; }
+	int indexOf(const String& s) const { size_t i = _s.find(s._s); return i == std::string::npos ? -1 : (int) i; }
+
+	long toInt() const { return atol(_s.c_str()); }
+	float toFloat() const { return (float) atof(_s.c_str()); }
+
+	bool concat(const String& s) { _s += s._s; return true; }
+	bool concat(const char* s) { if (s) _s += s; return true; }
+	bool concat(char c) { _s += c; return true; }
+	template <typename T>
+	bool concat(T value) { return concat(String(value)); }
+public:
+	template <typename T>
+	String& operator+=(const T& rhs) { concat(rhs); return *this; }
+
+	bool operator==(const String& rhs) const { return _s == rhs._s; }
+	bool operator==(const char* rhs) const { return _s == (rhs ? rhs : ""); }
+	bool operator!=(const String& rhs) const { return !(*this == rhs); }
+	bool operator!=(const char* rhs) const { return !(*this == rhs); }
+	bool operator<(const String& rhs) const { return _s < rhs._s; }
+private:
+	template <typename T>
+	void fromUnsigned(T value, unsigned char base) {
+		char buf[8 * sizeof(T) + 1];
+		char* p = &buf[sizeof(buf) - 1];
+		*p = '\0';
+		if (base < 2) base = 10;
+		do {
+			char d = (char) (value % base);
+			*--p = d < 10 ? d + '0' : d + 'A' - 10;
+			value /= base;
+		} while (value);
+		_s = p;
+	}
+
+	template <typename T>
+	void fromSigned(T value, unsigned char base) {
+		if (base == DEC && value < 0) {
+			fromUnsigned((unsigned long long) -(long long) value, base);
+			_s.insert(_s.begin(), '-');
+		} else {
+			fromUnsigned((unsigned long long) value & (~0ULL >> (64 - 8 * sizeof(T))), base);
+		}
+	}
+
+	void fromDouble(double value, unsigned char decimalPlaces) {
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+		_s = buf;
+	}
+private:
+	std::string _s;
+};
+
+template <typename T>
+inline String operator+(const String& lhs, const T& rhs) {
+	String r(lhs);
+	r += rhs;
+	return r;
+}
+
+inline String operator+(const char* lhs, const String& rhs) {
+	String r(lhs);
+	r += rhs;
+	return r;
+}
+
+#endif
@@ -0,0 +1,320 @@
+#include <chrono>
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+
+namespace {
+
+struct pin_state {
+	uint8_t mode;
+	bool driven;      // set from the outside through set_input()
+	bool input;       // level applied from the outside
+	bool output;      // level written by the sketch
+	int analog;
+	int pwm;
+	std::string shifted;
+};
+
+uint64_t g_now_us = 0;
+uint32_t g_loop_cost_us = 10;
+uint64_t g_loops = 0;
+bool g_stop = false;
+volatile bool g_interrupt = false;
+pin_state g_pins[arduino_host::PinCount];
+unsigned long g_random = 1;
+
+pin_state* pin_at(uint8_t pin) {
+	return pin < arduino_host::PinCount ? &g_pins[pin] : nullptr;
+}
+
+} // namespace
+
+HardwareSerial Serial(true);
+
+namespace arduino_host {
+
+uint64_t now_us() { return g_now_us; }
+void set_time_us(uint64_t us) { g_now_us = us; }
+void advance_us(uint64_t us) { g_now_us += us; }
+
+void set_loop_cost_us(uint32_t us) { g_loop_cost_us = us; }
+uint32_t loop_cost_us() { return g_loop_cost_us; }
+
+uint64_t idle_until_us(uint64_t us) {
+	if (g_interrupt) {
+		g_interrupt = false;
+		return g_now_us;
+	}
+	if (us > g_now_us) g_now_us = us;
+	return g_now_us;
+}
+
+void raise_interrupt() { g_interrupt = true; }
+
+void set_input(uint8_t pin, bool level) {
+	if (pin_state* p = pin_at(pin)) {
+		p->driven = true;
+		p->input = level;
+	}
+}
+
+void set_analog(uint8_t pin, int value) {
+	if (pin_state* p = pin_at(pin)) p->analog = value;
+}
+
+void release_input(uint8_t pin) {
+	if (pin_state* p = pin_at(pin)) p->driven = false;
+}
+
+bool output(uint8_t pin) {
+	pin_state* p = pin_at(pin);
+	return p ? p->output : false;
+}
+
+int pwm_output(uint8_t pin) {
+	pin_state* p = pin_at(pin);
+	return p ? p->pwm : 0;
+}
+
+uint8_t mode(uint8_t pin) {
+	pin_state* p = pin_at(pin);
+	return p ? p->mode : INPUT;
+}
+
+size_t take_shifted(uint8_t dataPin, uint8_t* out, size_t max) {
+	pin_state* p = pin_at(dataPin);
+	if (!p) return 0;
+	size_t n = p->shifted.size() < max ? p->shifted.size() : max;
+	memcpy(out, p->shifted.data(), n);
+	p->shifted.erase(0, n);
+	return n;
+}
+
+void request_stop() { g_stop = true; }
+bool stop_requested() { return g_stop; }
+uint64_t loop_count() { return g_loops; }
+
+uint64_t wall_ns() {
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace arduino_host
+
+// TIME
+
+unsigned long millis() { return (unsigned long) (uint32_t) (g_now_us / 1000); }
+unsigned long micros() { return (unsigned long) (uint32_t) g_now_us; }
+void delay(unsigned long ms) { g_now_us += (uint64_t) ms * 1000; }
+void delayMicroseconds(unsigned int us) { g_now_us += us; }
+void yield() {}
+
+// DIGITAL AND ANALOG I/O
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	if (pin_state* p = pin_at(pin)) p->mode = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	if (pin_state* p = pin_at(pin)) p->output = val != LOW;
+}
+
+int digitalRead(uint8_t pin) {
+	pin_state* p = pin_at(pin);
+	if (!p) return LOW;
+	if (p->driven) return p->input ? HIGH : LOW;
+	if (p->mode == OUTPUT) return p->output ? HIGH : LOW;
+	return p->mode == INPUT_PULLUP ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+	pin_state* p = pin_at(pin);
+	return p ? p->analog : 0;
+}
+
+void analogWrite(uint8_t pin, int val) {
+	if (pin_state* p = pin_at(pin)) {
+		p->pwm = val;
+		p->output = val >= 128;
+	}
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val) {
+	(void) clockPin;
+	if (bitOrder == LSBFIRST) {
+		uint8_t r = 0;
+		for (int i = 0; i < 8; i++)
+			if (val & (1 << i)) r |= (uint8_t) (0x80 >> i);
+		val = r;
+	}
+	if (pin_state* p = pin_at(dataPin)) p->shifted.push_back((char) val);
+	// 8 clock pulses of two digitalWrite() calls each on a 16MHz AVR
+	g_now_us += 8;
+}
+
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
+	(void) clockPin;
+	uint8_t value = 0;
+	for (int i = 0; i < 8; i++) {
+		int b = digitalRead(dataPin);
+		if (bitOrder == LSBFIRST) value |= (uint8_t) (b << i);
+		else value |= (uint8_t) (b << (7 - i));
+	}
+	g_now_us += 8;
+	return value;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+long random(long howbig) {
+	if (howbig == 0) return 0;
+	g_random = g_random * 1103515245UL + 12345UL;
+	return (long) ((g_random >> 16) % (unsigned long) howbig);
+}
+
+long random(long howsmall, long howbig) {
+	if (howsmall >= howbig) return howsmall;
+	return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+	if (seed != 0) g_random = seed;
+}
+
+// STREAMS
+
+int Stream::timedRead() {
+	uint64_t deadline = g_now_us + (uint64_t) _timeout * 1000;
+	for (;;) {
+		int c = read();
+		if (c >= 0) return c;
+		if (g_now_us >= deadline) return -1;
+		// nothing arrived yet, let virtual time pass in 1ms steps
+		g_now_us += 1000;
+	}
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+	size_t count = 0;
+	while (count < length) {
+		int c = timedRead();
+		if (c < 0) break;
+		*buffer++ = (char) c;
+		count++;
+	}
+	return count;
+}
+
+String Stream::readString() {
+	String ret;
+	int c = timedRead();
+	while (c >= 0) {
+		ret += (char) c;
+		c = timedRead();
+	}
+	return ret;
+}
+
+void HardwareSerial::drain() {
+	uint64_t byteTime = byteTimeUs();
+	if (byteTime == 0) {
+		_txQueued = 0;
+		_lastDrainUs = g_now_us;
+		return;
+	}
+	if (_txQueued == 0) {
+		_lastDrainUs = g_now_us;
+		return;
+	}
+	uint64_t sent = (g_now_us - _lastDrainUs) / byteTime;
+	if (sent >= (uint64_t) _txQueued) {
+		_txQueued = 0;
+		_lastDrainUs = g_now_us;
+	} else {
+		_txQueued -= (int) sent;
+		_lastDrainUs += sent * byteTime;
+	}
+}
+
+int HardwareSerial::availableForWrite() {
+	drain();
+	return TxBufferSize - 1 - _txQueued;
+}
+
+void HardwareSerial::flush() {
+	drain();
+	g_now_us += (uint64_t) _txQueued * byteTimeUs();
+	drain();
+	fflush(stdout);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+	drain();
+	// a full TX buffer blocks the caller until the UART made room, just like the AVR core
+	if (_txQueued >= TxBufferSize - 1) {
+		g_now_us = _lastDrainUs + byteTimeUs();
+		drain();
+	}
+	_txQueued++;
+	_sent.push((char) c);
+	if (_echo) fputc(c, stdout);
+	return 1;
+}
+
+size_t SoftwareSerial::write(uint8_t c) {
+	// bit-banged with interrupts disabled: 1 start, 8 data and 1 stop bit
+	if (_baud > 0) g_now_us += 10000000ULL / (uint64_t) _baud;
+	_sent.push((char) c);
+	if (_responder) _responder(*this, c);
+	return 1;
+}
+
+#ifndef ARDUINO_HOST_NO_MAIN
+
+/*
+Runs the sketch in virtual time.
+
+Options:
+	--duration-ms N   stop after N ms of virtual time (default 10000)
+	--max-loops N     stop after N loop() iterations
+	--loop-us N       virtual time consumed by one loop() iteration (default 10)
+	--quiet           do not echo Serial output to stdout
+*/
+int main(int argc, char** argv) {
+	uint64_t durationMs = 10000;
+	uint64_t maxLoops = 0;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : "0";
+		if (!strcmp(arg, "--duration-ms")) { durationMs = strtoull(value, nullptr, 10); i++; }
+		else if (!strcmp(arg, "--max-loops")) { maxLoops = strtoull(value, nullptr, 10); i++; }
+		else if (!strcmp(arg, "--loop-us")) { g_loop_cost_us = (uint32_t) strtoul(value, nullptr, 10); i++; }
+		else if (!strcmp(arg, "--quiet")) Serial.setEcho(false);
+		else {
+			fprintf(stderr, "usage: %s [--duration-ms N] [--max-loops N] [--loop-us N] [--quiet]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	uint64_t wallStart = arduino_host::wall_ns();
+	setup();
+
+	uint64_t endUs = g_now_us + durationMs * 1000;
+	while (!g_stop && g_now_us < endUs && (maxLoops == 0 || g_loops < maxLoops)) {
+		loop();
+		g_loops++;
+		g_now_us += g_loop_cost_us;
+	}
+	fflush(stdout);
+
+	double wallMs = (double) (arduino_host::wall_ns() - wallStart) / 1e6;
+	double virtMs = (double) g_now_us / 1e3;
+	fprintf(stderr, "\n[arduino_host] %llu loops, %.3f ms virtual in %.3f ms wall (x%.0f)\n",
+		(unsigned long long) g_loops, virtMs, wallMs, wallMs > 0 ? virtMs / wallMs : 0.0);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _ARDUINO_HOST_
+#define _ARDUINO_HOST_
+
+/*
+Control surface of the host Arduino stub.
+
+Time on the host is virtual: millis()/micros() read a counter that only moves when
+delay() is called, when a (software) serial port is blocked on transmission, when
+the host main() finishes a loop() iteration or when a bench/test advances it by hand.
+Code under test therefore runs as fast as the workstation allows while still seeing
+a consistent Arduino time line, including the 32-bit millis()/micros() wraparound.
+
+Pins live in a virtual pin bank. Inputs are driven from the outside with set_input()
+and set_analog(), outputs written by the sketch can be read back with output().
+
+Basic usage:
+	arduino_host::set_input(2, LOW);       // press a button wired to pin 2
+	arduino_host::advance_ms(50);           // let 50ms of virtual time pass
+	if (arduino_host::output(13)) ...       // was the LED switched on?
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace arduino_host {
+
+// Number of pins in the virtual pin bank
+const uint8_t PinCount = 64;
+
+// VIRTUAL CLOCK
+uint64_t now_us();
+void set_time_us(uint64_t us);
+void advance_us(uint64_t us);
+inline void advance_ms(uint64_t ms) { advance_us(ms * 1000); }
+
+// Virtual time that passes for every loop() iteration run by the host main()
+void set_loop_cost_us(uint32_t us);
+uint32_t loop_cost_us();
+
+// Sleeps the virtual clock until 'us', or until an interrupt is raised with raise_interrupt().
+// Returns the virtual time at which it woke up.
+uint64_t idle_until_us(uint64_t us);
+void raise_interrupt();
+
+// VIRTUAL PIN BANK
+void set_input(uint8_t pin, bool level);
+void set_analog(uint8_t pin, int value);
+void release_input(uint8_t pin);
+bool output(uint8_t pin);
+int pwm_output(uint8_t pin);
+uint8_t mode(uint8_t pin);
+// Bytes shifted out through shiftOut() on a data pin since the last call
+size_t take_shifted(uint8_t dataPin, uint8_t* out, size_t max);
+
+// RUN CONTROL
+void request_stop();
+bool stop_requested();
+uint64_t loop_count();
+
+// Wall clock of the workstation, used to report how much faster than real time we run
+uint64_t wall_ns();
+
+} // namespace arduino_host
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "sta.h"
 #include <Arduino.h>
+#include "./core/clock.h"
+#include "./core/profile.h"
 
 BEGIN_NP_BLOCK
 
@@ -51,7 +53,7 @@ public:
     void loop(void) {
         // read the state of the switch/button:
         int32 currentState = digitalRead(this->btnPin);
-        uint64 currentTime = millis();
+        uint64 currentTime = loop_clock::now();
 
         // check to see if you just pressed the button
         // (i.e. the input went from LOW to HIGH), and you've waited long enough
@@ -290,10 +292,11 @@ public: // GETTERS/SETTERS
 
     bool getKeys() {
         bool keyActivity = false;
-        if ((millis() - startTime) > debounceTime) {
+        uint64 now = loop_clock::now();
+        if ((now - startTime) > debounceTime) {
             scanKeys();
             keyActivity = updateList();
-            startTime = millis();
+            startTime = now;
         }
         return keyActivity;
     }
@@ -320,6 +323,7 @@ private:
     bool single_key;
 private:
     void scanKeys() {
+        STA_PROFILE_ZONE("keypad scanKeys");
         for (byte r = 0; r < this->sizeKpd.rows; r++) 
             this->pin_mode(this->rowPins[r], INPUT_PULLUP);
         
@@ -388,11 +392,11 @@ private:
         case key_state::IDLE:
             if (button == CLOSED) {
                 transitionTo(idx, key_state::PRESSED);
-                holdTimer = millis();
+                holdTimer = loop_clock::now();
             }		// Get ready for next HOLD state.
             break;
         case key_state::PRESSED:
-            if ((millis() - holdTimer) > holdTime)	// Waiting for a key_list HOLD...
+            if ((loop_clock::now() - holdTimer) > holdTime)	// Waiting for a key_list HOLD...
                 transitionTo(idx, key_state::HOLD);
             else if (button == OPEN)				// or for a key_list to be RELEASED.
                 transitionTo(idx, key_state::RELEASED);
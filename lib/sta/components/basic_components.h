@@ -7,6 +7,8 @@
 #include "sta.h"
 #include "./core/memory.h"
 #include "./core/containers.h"
+#include "./core/timer_wheel.h"
+#include "./core/clock.h"
 #include "pins.h"
 #include "./types/callback.h"
 
@@ -18,10 +20,20 @@ this is the class to extend if you want to create custom components.
  Custom components should:
  - Override privateLoop
  - Call RegisterChild on children (not mendatory)
+
+By default the children are kept in a heap allocated vector. Define
+STA_COMPONENT_MAX_CHILDREN before including sta to store them inline instead,
+RegisterChild then ignores children past that limit.
 */
 class _STAXXEXPORT component {
 public:
-    component(ref_ptr<component> parent = nullptr) : _parent(parent), _children(5), _isLooping(false) {}
+#ifdef STA_COMPONENT_MAX_CHILDREN
+    typedef static_vector<ref_ptr<component>, STA_COMPONENT_MAX_CHILDREN> child_list;
+#else
+    typedef vector<ref_ptr<component>> child_list;
+#endif
+public:
+    component(ref_ptr<component> parent = nullptr) : _parent(parent), _children(), _isLooping(false) {}
     void loop() {
         _isLooping = true;
         loopChildren();
@@ -30,9 +42,7 @@ public:
         }
     }
 
-    virtual ~component() {
-        this->_children.~vector();
-    }
+    virtual ~component() = default;
 protected:
     void SkipLoop() {
         _isLooping = false;
@@ -56,7 +66,7 @@ private:
     virtual void privateLoop() = 0;
 private:
     ref_ptr<component> _parent;
-    vector<ref_ptr<component>> _children;
+    child_list _children;
     bool _isLooping;
 };
 
@@ -125,7 +135,7 @@ public:
 	
         this->blinking = true;
         this->millisLeft = this->blinkInterval = interval;
-        this->lastMillis = millis();
+        this->lastMillis = loop_clock::now();
     }
 
 	void stopBlinking() {
@@ -146,8 +156,9 @@ private:
 	void privateLoop() override {
         if(!blinking) return;
         
-        auto deltaSinceLastUpdate = millis() - this->lastMillis;
-        this->lastMillis = millis();
+        int64 now = loop_clock::now();
+        auto deltaSinceLastUpdate = now - this->lastMillis;
+        this->lastMillis = now;
         this->millisLeft -= deltaSinceLastUpdate;
         
         if (this->millisLeft < 0) {
@@ -226,14 +237,15 @@ BasicUsage:
 	}, 1500); // 1500 -> is the interval in milliseconds
 
 
-	// Always needed:
+	// Needed when not using the framework (entry_point.h):
 	void loop() {
 		// ... Code
 		t.loop();
 		// ... Code
 	}
 Notes:
-	- Timer has a state so its `loop` function must be called for it to work!
+	- All timers are kept in one shared timing wheel (see core/timer_wheel.h), which entry_point.h
+	  updates every loop. Without the framework, calling `loop` on any timer updates the wheel.
 	- You don't have to use lambda function, you could pass a normal function (it must have no parameters).
 	- calling setTimeout(..) while timer is already running (when isRunning() returns `true`) will cancel the 
 	  already running timer and will restart it for the specified callback and delay.
@@ -244,54 +256,56 @@ public:
     timer(ref_ptr<component> parent) _STAXX_NOEXCEPT
         : 
             component(parent), _timeout_callback([](){}),
-            _timer_running(false), _deadline(0) 
+            _interval(0), _intervaling(false) 
         {}
 public:
     void setTimeout(void_callback callback, uint64 delay) {
         this->cancel();
 		this->_intervaling = false;
-		this->_timer_running = true;
 		this->_timeout_callback = callback;
-		this->_deadline = millis() + delay;
+		this->schedule(delay);
     }
 
     void onInterval(void_callback callback, uint64 interval) {
         this->cancel();
 		this->_interval = interval;
 		this->_intervaling = true;
-		this->_timer_running = true;
 		this->_timeout_callback = callback;
-		this->_deadline = millis() + interval;
+		this->schedule(interval);
     }
 
     void cancel() {
-        this->_timer_running = false;
+        this->_entry.cancel();
     }
 public:
     inline bool isRunning() {
-        return this->_timer_running;
+        return this->_entry.isScheduled();
     }
 
     inline uint64 timeLeft() {
-        return this->_deadline - millis();
+        int32_t left = (int32_t) (this->_entry.deadline() - (uint32_t) loop_clock::now());
+        return left > 0 ? left : 0;
     }
 private:
+    void schedule(uint64 delay) {
+        this->_entry.bind(&timer::expired, this);
+        timers().schedule(this->_entry, (uint32_t) (loop_clock::now() + delay));
+    }
+
+    static void expired(void* context) {
+        timer& self = *static_cast<timer*>(context);
+        if (self._intervaling)
+            self.schedule(self._interval);
+        self._timeout_callback();
+    }
+
+    // The shared wheel fires the timer, looping it keeps the wheel running without entry_point.h
     void privateLoop() override {
-        if(!_timer_running) return;
-		if(millis() >= _deadline) {
-			if(_intervaling) {
-				_deadline = millis() + _interval;
-				_timeout_callback();
-			} else {
-				cancel();
-				_timeout_callback();
-			}
-		}
+        timers().update((uint32_t) loop_clock::now());
     }
 private:
     void_callback _timeout_callback;
-    bool _timer_running;
-    uint64 _deadline;
+    timer_entry _entry;
     
     uint64 _interval;
     bool _intervaling;
@@ -31,12 +31,7 @@
 #include <Arduino.h>
 #include "sta.h"
 #include "utility.h"
-
-
-BEGIN_NP_BLOCK
-
-#pragma GCC visibility push(default)
-#pragma GCC diagnostic ignored "-Wshift-count-overflow"
+#include "./core/profile.h"
 
 #if defined(HARDWARE_SERIAL)
 # define USE_HARDWARE_SERIAL
@@ -50,6 +45,11 @@ BEGIN_NP_BLOCK
 # include <HardwareSerial.h>
 #endif
 
+BEGIN_NP_BLOCK
+
+#pragma GCC visibility push(default)
+#pragma GCC diagnostic ignored "-Wshift-count-overflow"
+
 class _STAXXEXPORT nextion_serial {
 public:
   nextion_serial() = default;//Empty contructor
@@ -181,6 +181,7 @@ unsigned int nextion_serial::getComponentValue(String component){
 }
 
 boolean nextion_serial::setComponentText(String component, String txt){
+  STA_PROFILE_ZONE("nextion setComponentText");
   String componentText = component + ".txt=\"" + txt + "\"";
   this->sendCommand(componentText.c_str());
   return this->ack();
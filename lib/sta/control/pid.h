@@ -2,6 +2,8 @@
 #define _STA_CONTROL_pid_controller_
 
 #include "sta.h"
+#include "./core/clock.h"
+#include "./core/profile.h"
 
 #define AUTOMATIC	1
 #define MANUAL	0
@@ -36,7 +38,7 @@ public:
       this->SetControllerDirection(ControllerDirection);
       this->SetTunings(Kp, Ki, Kd, POn);
 
-      this->lastTime = millis() - this->SampleTime;
+      this->lastTime = (unsigned long) sta::loop_clock::now() - this->SampleTime;
   }
 
                                           
@@ -67,7 +69,8 @@ public:
   //   SetSampleTime respectively
   bool Compute() {
    if(!this->inAuto) return false;
-   unsigned long now = millis();
+   STA_PROFILE_ZONE("pid Compute");
+   unsigned long now = (unsigned long) sta::loop_clock::now();
    unsigned long timeChange = (now - this->lastTime);
    if(timeChange>=SampleTime) {
       /*Compute all the working error variables*/
@@ -2,6 +2,7 @@
 #define _PID_TUNER_
 
 #include "sta.h"
+#include "./core/clock.h"
 
 BEGIN_CONTROL_BLOCK
 
@@ -17,7 +18,7 @@ public:
 		running = false;
 		oStep = 30;
 		SetLookbackSec(10);
-		lastTime = millis();
+		lastTime = (unsigned long) sta::loop_clock::now();
 	}           
 
 	// * Similar to the PID Compue function, returns non 0 when done        	
@@ -29,7 +30,7 @@ public:
 			return 1;
 		}
 
-		unsigned long now = millis();
+		unsigned long now = (unsigned long) sta::loop_clock::now();
 		
 		if((now-lastTime)<sampleTime) return false;
 		lastTime = now;
@@ -0,0 +1,142 @@
+#ifndef _STA_CHANNEL_
+#define _STA_CHANNEL_
+
+#include "sta.h"
+#include "containers.h"
+#include "coroutine.h"
+
+/*
+Bounded FIFO for passing messages between coroutines, or from an interrupt handler
+to a coroutine.
+
+A channel holds up to N values of type T in a ring buffer. try_send() and try_recv()
+never block and return false when the channel is full or empty. Inside a coroutine,
+COROUTINE_SEND and COROUTINE_RECV block instead: the coroutine waits on the channel's
+events, costing nothing in update() until the other side makes room or sends data.
+
+    sta::channel<int, 8> samples;
+    sta::channel<int, 4> filtered;
+
+    void sensor(COROUTINE_CONTEXT(coroutine))
+    {
+        COROUTINE_LOCAL(int, value);
+
+        BEGIN_COROUTINE;
+
+        value = analogRead(A0);
+        COROUTINE_SEND(samples, value);
+
+        coroutine.wait(10);
+        COROUTINE_YIELD;
+
+        coroutine.loop();
+
+        END_COROUTINE;
+    }
+
+    void filter(COROUTINE_CONTEXT(coroutine))
+    {
+        COROUTINE_LOCAL(int, value);
+        COROUTINE_LOCAL(int, average);
+
+        BEGIN_COROUTINE;
+
+        average = 0;
+        for (;;)
+        {
+            COROUTINE_RECV(samples, value);
+            average = (average * 3 + value) / 4;
+            COROUTINE_SEND(filtered, average);
+        }
+
+        END_COROUTINE;
+    }
+
+The value and variable given to the macros are used again after the coroutine
+resumes, so they must be coroutine locals or globals. Each macro yields, so it
+cannot share its line with another yield.
+
+A C++20 task (see task.h) blocks the same way with wait_event:
+
+    int value;
+    while (!samples.try_recv(value))
+        co_await sta::wait_event(samples.readable());
+
+Any number of coroutines may send and receive on one channel, since coroutines
+never preempt each other. An interrupt handler may be the one and only sender, or
+the one and only receiver. Every blocked coroutine on a side wakes up when the
+channel changes, and those that lose the race block again. A try_recv() that empties
+the channel takes back the signal of readable(), and a try_send() that fills it the
+signal of writable(), so the next blocking call on that side does not wake up for
+nothing.
+*/
+
+BEGIN_NP_BLOCK
+
+template <class T, size_t N>
+class _STAXXEXPORT channel {
+public:
+    // Queues a copy of value, returns false if the channel is full
+    bool try_send(const T& value) {
+        if (!this->buffer.push(value))
+            return false;
+        this->dataReady.signal();
+        if (this->buffer.full())
+        {
+            // no room left to wake a sender for, unless an interrupt handler received meanwhile
+            this->spaceReady.clear();
+            if (!this->buffer.full())
+                this->spaceReady.signal();
+        }
+        return true;
+    }
+
+    // Takes the oldest value, returns false if the channel is empty
+    bool try_recv(T& value) {
+        if (!this->buffer.pop(value))
+            return false;
+        this->spaceReady.signal();
+        if (this->buffer.empty())
+        {
+            // nothing left to wake a receiver for, unless an interrupt handler sent meanwhile
+            this->dataReady.clear();
+            if (!this->buffer.empty())
+                this->dataReady.signal();
+        }
+        return true;
+    }
+
+    size_t size() const { return this->buffer.size(); }
+    bool empty() const { return this->buffer.empty(); }
+    bool full() const { return this->buffer.full(); }
+    static constexpr size_t capacity() { return N; }
+
+    // Signalled whenever a value is sent
+    event& readable() { return this->dataReady; }
+    // Signalled whenever a value is received
+    event& writable() { return this->spaceReady; }
+private:
+    ring_buffer<T, N> buffer;
+    event dataReady;
+    event spaceReady;
+};
+
+END_NP_BLOCK
+
+// Sends value on the channel, blocking the coroutine while the channel is full
+#define COROUTINE_SEND(channel, value)                          \
+    while (!(channel).try_send(value))                          \
+    {                                                           \
+        COROUTINE_ctx.wait_event((channel).writable());         \
+        COROUTINE_YIELD;                                        \
+    }
+
+// Receives into variable, blocking the coroutine while the channel is empty
+#define COROUTINE_RECV(channel, variable)                       \
+    while (!(channel).try_recv(variable))                       \
+    {                                                           \
+        COROUTINE_ctx.wait_event((channel).readable());         \
+        COROUTINE_YIELD;                                        \
+    }
+
+#endif
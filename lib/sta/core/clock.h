@@ -0,0 +1,84 @@
+#ifndef _STA_CLOCK_
+#define _STA_CLOCK_
+
+#include "sta.h"
+
+BEGIN_NP_BLOCK
+
+/*
+Framework clock, one millisecond timestamp per loop iteration.
+
+entry_point.h calls tick() at the start of every loop(): it reads millis() once and
+extends it to a 64-bit count that does not wrap around after 49.7 days. Until the
+next tick(), now() returns that same time, so the timers, components and
+controllers updated in one iteration all see one consistent timestamp. They also
+stop reading millis() over and over, which briefly disables interrupts on AVR.
+
+Without the framework nobody calls tick(), and now() reads millis() itself.
+
+Basic usage:
+    sta::uint64 started = sta::loop_clock::now();
+    ...
+    if (sta::loop_clock::now() - started >= 1000) {
+        ...
+    }
+
+Since the time only moves between iterations, code waiting in a loop within one
+iteration must use millis() or read() instead. The clock is not meant for
+interrupt handlers. It must be read at least once every 49.7 days to notice the
+wrap-around of millis().
+*/
+class _STAXXEXPORT loop_clock {
+public:
+    // Samples the time of a new loop iteration, now() returns it until the next tick()
+    static uint64 tick() {
+        state& s = get();
+        s.held = read();
+        s.ticking = true;
+        return s.held;
+    }
+
+    // Milliseconds since start of the current loop iteration, or of this call without the framework
+    static uint64 now() {
+        state& s = get();
+        return s.ticking ? s.held : read();
+    }
+
+    // Milliseconds since start right now, extended to 64 bits
+    static uint64 read() {
+        state& s = get();
+        uint32_t raw = millis();
+        if (raw < s.last)
+            s.high++;
+        s.last = raw;
+        return ((uint64) s.high << 32) | raw;
+    }
+
+    // Microseconds until millis() reaches ms, 0 once it has. Saturates a little above an hour.
+    static unsigned long micros_until(uint32_t ms) {
+        int32_t left = (int32_t) (ms - (uint32_t) millis());
+        if (left <= 0)
+            return 0;
+        if (left > 4000000L)
+            left = 4000000L;
+        // the millisecond running now is partly over
+        return (unsigned long) left * 1000UL - (uint32_t) micros() % 1000UL;
+    }
+private:
+    struct state {
+        uint64 held;
+        // millis() at the last read and the number of times it wrapped around
+        uint32_t last;
+        uint32_t high;
+        bool ticking;
+    };
+
+    static state& get() {
+        static state s = { 0, 0, 0, false };
+        return s;
+    }
+};
+
+END_NP_BLOCK
+
+#endif
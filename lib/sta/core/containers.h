@@ -67,49 +67,92 @@ private:
     initializer_list(const T* a, size_t l) : array(a), len(l) { }
 };
 
-#define ScaleFactor 1.75;
-
-template <class Ty>
-class _STAXXEXPORT vector {
+/*
+Dynamic array with amortized growth.
+
+Storage is raw memory: slots past size() are never constructed, elements are
+placement-new'ed into it and moved, not copied, when the storage grows.
+Trivially copyable element types are relocated with a single memcpy.
+The storage comes from Alloc, the heap by default or a pool through pool_allocator.
+
+Basic usage:
+	sta::vector<int> v;
+	v.reserve(16);
+	v.push(1);
+	v.emplace_back(2);
+	int last = v.pop();
+*/
+template <class Ty, class Alloc = allocator<Ty>>
+class _STAXXEXPORT vector : private Alloc {
 public:
 	typedef unsigned Size;
+	typedef Alloc allocator_type;
 public:
-	vector(Size initialCpacity = 5) {
-		firstElement = afterLastElement = new Ty[initialCpacity];
-		capacity = initialCpacity;
+	vector(Size initialCpacity = 5) 
+		: Alloc(), firstElement(nullptr), afterLastElement(nullptr), endOfStorage(nullptr) 
+	{
+		reserve(initialCpacity);
+	}
+
+	explicit vector(const Alloc& alloc, Size initialCpacity = 5) 
+		: Alloc(alloc), firstElement(nullptr), afterLastElement(nullptr), endOfStorage(nullptr) 
+	{
+		reserve(initialCpacity);
 	}
 
 	template <size_t C>
-	vector(const data<Ty, C>& __data) {
-		for (int32 i = 0; i < C; i++) 
+	vector(const data<Ty, C>& __data) : vector(C) {
+		for (Size i = 0; i < C; i++) 
 			this->push(__data[i]);
 	}
 
+	// Stays empty when the storage for the copy cannot be allocated
+	vector(const vector& other) : vector(other.get_allocator(), 0) {
+		if (reserve(other.size()))
+			copyFrom(other);
+	}
+
+	vector(vector&& other) _STAXX_NOEXCEPT
+		: Alloc(other.get_allocator()),
+		firstElement(other.firstElement), 
+		afterLastElement(other.afterLastElement), 
+		endOfStorage(other.endOfStorage)
+	{
+		other.firstElement = other.afterLastElement = other.endOfStorage = nullptr;
+	}
+
 	~vector() {
 		dispose();
 	}
 public:
+	bool push(const Ty& item) {
+		if (!grow()) return false;
+		new(static_cast<void*>(afterLastElement)) Ty(item);
+		afterLastElement++;
+		return true;
+	}
 
-	void push(Ty& item) {
-		if (size() == capacity) {
-			resize();
-		}
-		*afterLastElement = item;
+	bool push(Ty&& item) {
+		if (!grow()) return false;
+		new(static_cast<void*>(afterLastElement)) Ty(sta::move(item));
 		afterLastElement++;
+		return true;
 	}
 
-	void push(Ty&& item) {
-		if (size() == capacity) {
-			resize();
-		}
-		*afterLastElement = item;
+	// Constructs the new element in place from the given constructor arguments
+	template <typename... Args>
+	bool emplace_back(Args&&... args) {
+		if (!grow()) return false;
+		new(static_cast<void*>(afterLastElement)) Ty(sta::forward<Args>(args)...);
 		afterLastElement++;
+		return true;
 	}
 
 	Ty pop() {
 		//if(empty()) throw "Vector is empty, cant pop()";
-		auto retVal = *(afterLastElement - 1);
 		afterLastElement -= 1;
+		Ty retVal(sta::move(*afterLastElement));
+		afterLastElement->~Ty();
 		return retVal;
 	}
 
@@ -117,40 +160,381 @@ public:
 		//if(index < size()) throw "Vector index is bad, probably not less than size()";
 		return *(firstElement + index);
 	}
+
+	const Ty& get(Size index) const {
+		return *(firstElement + index);
+	}
+
 	Size size() const {
 		return afterLastElement - firstElement;
 	}
 
+	Size capacity() const {
+		return endOfStorage - firstElement;
+	}
+
 	bool empty() const {
 		return size() == 0;
 	}
-private:
-	Ty* firstElement;
-	Ty* afterLastElement;
-	Size capacity;
 
-	void resize() {
-		Size newCapacity = capacity * ScaleFactor;
-		Ty *newFirst, *newAfterLast;
-		newFirst = newAfterLast = new Ty[newCapacity];
+	// Makes room for at least newCapacity elements, returns false when out of memory
+	bool reserve(Size newCapacity) {
+		if (newCapacity <= capacity()) return true;
+		return relocate(newCapacity);
+	}
 
-		for (Size i = 0; i < capacity; i++) {
-			*newAfterLast = get(i);
-			++newAfterLast;
+	// Gives back the unused capacity to the allocator
+	void shrink_to_fit() {
+		if (size() == capacity()) return;
+		if (empty()) {
+			dispose();
+			firstElement = afterLastElement = endOfStorage = nullptr;
+			return;
 		}
+		relocate(size());
+	}
+
+	// Destroys all elements, the capacity is kept
+	void clear() {
+		destroy(firstElement, afterLastElement);
+		afterLastElement = firstElement;
+	}
+
+	const Alloc& get_allocator() const _STAXX_NOEXCEPT { return *this; }
+public:
+	Ty* begin() _STAXX_NOEXCEPT { return firstElement; }
+	const Ty* begin() const _STAXX_NOEXCEPT { return firstElement; }
+	Ty* end() _STAXX_NOEXCEPT { return afterLastElement; }
+	const Ty* end() const _STAXX_NOEXCEPT { return afterLastElement; }
+public:
+	vector& operator=(const vector& other) {
+		if (this == &other) return *this;
+		clear();
+		if (reserve(other.size()))
+			copyFrom(other);
+		return *this;
+	}
 
+	vector& operator=(vector&& other) _STAXX_NOEXCEPT {
+		if (this == &other) return *this;
 		dispose();
+		static_cast<Alloc&>(*this) = other.get_allocator();
+		firstElement = other.firstElement;
+		afterLastElement = other.afterLastElement;
+		endOfStorage = other.endOfStorage;
+		other.firstElement = other.afterLastElement = other.endOfStorage = nullptr;
+		return *this;
+	}
+
+	inline Ty& operator[](Size i) { return firstElement[i]; }
+	inline const Ty& operator[](Size i) const { return firstElement[i]; }
+private:
+	Ty* firstElement;
+	Ty* afterLastElement;
+	Ty* endOfStorage;
+
+	// Grows the storage by a factor of 1.75 when it is full
+	bool grow() {
+		if (afterLastElement != endOfStorage) return true;
+		Size current = capacity();
+		Size newCapacity = current + (current * 3) / 4;
+		if (newCapacity <= current) newCapacity = current + 1;
+		return relocate(newCapacity);
+	}
+
+	// Moves the elements to a new block of newCapacity slots
+	bool relocate(Size newCapacity) {
+		Ty* newFirst = this->allocate(newCapacity);
+		if (newFirst == nullptr) return false;
+
+		Size count = size();
+		if (is_trivially_copyable<Ty>::value) {
+			if (count) memcpy(static_cast<void*>(newFirst), static_cast<const void*>(firstElement), count * sizeof(Ty));
+		} else {
+			for (Size i = 0; i < count; i++)
+				new(static_cast<void*>(newFirst + i)) Ty(sta::move(firstElement[i]));
+			destroy(firstElement, afterLastElement);
+		}
+		if (firstElement) this->deallocate(firstElement, capacity());
 
-		capacity = newCapacity;
 		firstElement = newFirst;
-		afterLastElement = newAfterLast;
+		afterLastElement = newFirst + count;
+		endOfStorage = newFirst + newCapacity;
+		return true;
+	}
+
+	// Appends copies of the elements of other to an empty vector with room for them
+	void copyFrom(const vector& other) {
+		Size count = other.size();
+		if (count > capacity()) return;
+		if (is_trivially_copyable<Ty>::value) {
+			if (count) memcpy(static_cast<void*>(firstElement), static_cast<const void*>(other.firstElement), count * sizeof(Ty));
+			afterLastElement = firstElement + count;
+		} else {
+			for (Size i = 0; i < count; i++)
+				push(other.firstElement[i]);
+		}
+	}
+
+	static void destroy(Ty* first, Ty* last) {
+		if (is_trivially_destructible<Ty>::value) return;
+		for (; first != last; ++first)
+			first->~Ty();
 	}
 
 	void dispose() {
-		delete[] firstElement;
+		destroy(firstElement, afterLastElement);
+		if (firstElement) this->deallocate(firstElement, capacity());
+	}
+};
+
+
+/*
+Fixed-capacity vector with inline storage, it never touches the heap.
+
+Same push/pop/get/size surface as sta::vector, but the capacity N is part of the
+type: push() returns false once N elements are stored instead of growing.
+
+Basic usage:
+	sta::static_vector<int, 8> samples;
+	samples.push(analogRead(A0));
+	if (samples.full()) ...
+*/
+template <class Ty, size_t N>
+class _STAXXEXPORT static_vector {
+public:
+	typedef unsigned Size;
+public:
+	static_vector() : count(0) {}
+
+	template <size_t C>
+	static_vector(const data<Ty, C>& __data) : count(0) {
+		static_assert(C <= N, "static_vector capacity is too small for the initial data");
+		for (Size i = 0; i < C; i++) 
+			this->push(__data[i]);
+	}
+
+	static_vector(const static_vector& other) : count(0) {
+		for (Size i = 0; i < other.size(); i++)
+			this->push(other.get(i));
+	}
+
+	~static_vector() {
+		clear();
+	}
+public:
+	bool push(const Ty& item) {
+		if (full()) return false;
+		new(static_cast<void*>(slot(count))) Ty(item);
+		count++;
+		return true;
+	}
+
+	bool push(Ty&& item) {
+		if (full()) return false;
+		new(static_cast<void*>(slot(count))) Ty(sta::move(item));
+		count++;
+		return true;
+	}
+
+	template <typename... Args>
+	bool emplace_back(Args&&... args) {
+		if (full()) return false;
+		new(static_cast<void*>(slot(count))) Ty(sta::forward<Args>(args)...);
+		count++;
+		return true;
+	}
+
+	Ty pop() {
+		//if(empty()) throw "Vector is empty, cant pop()";
+		count--;
+		Ty retVal(sta::move(*slot(count)));
+		slot(count)->~Ty();
+		return retVal;
+	}
+
+	Ty& get(Size index) { return *slot(index); }
+	const Ty& get(Size index) const { return *slot(index); }
+
+	// Compile-time checked access
+	template <Size I>
+	Ty& get() {
+		static_assert(I < N, "static_vector index out of range");
+		return *slot(I);
 	}
+
+	Size size() const { return count; }
+	bool empty() const { return count == 0; }
+	bool full() const { return count == N; }
+	static constexpr Size capacity() { return N; }
+
+	void clear() {
+		if (is_trivially_destructible<Ty>::value) count = 0;
+		while (count) slot(--count)->~Ty();
+	}
+public:
+	Ty* begin() _STAXX_NOEXCEPT { return slot(0); }
+	const Ty* begin() const _STAXX_NOEXCEPT { return slot(0); }
+	Ty* end() _STAXX_NOEXCEPT { return slot(count); }
+	const Ty* end() const _STAXX_NOEXCEPT { return slot(count); }
+public:
+	static_vector& operator=(const static_vector& other) {
+		if (this == &other) return *this;
+		clear();
+		for (Size i = 0; i < other.size(); i++)
+			this->push(other.get(i));
+		return *this;
+	}
+
+	inline Ty& operator[](Size i) { return *slot(i); }
+	inline const Ty& operator[](Size i) const { return *slot(i); }
+private:
+	Ty* slot(Size i) { return reinterpret_cast<Ty*>(storage) + i; }
+	const Ty* slot(Size i) const { return reinterpret_cast<const Ty*>(storage) + i; }
+private:
+	alignas(Ty) unsigned char storage[N ? N * sizeof(Ty) : 1];
+	Size count;
 };
 
+/*
+Lock-free single-producer/single-consumer ring buffer.
+
+Meant to hand data from an interrupt handler to loop() (or the other way around):
+exactly one context may push and exactly one other context may pop, neither ever
+blocks or disables interrupts for long. N must be a power of two so the positions
+wrap with a mask. Up to N = 128 the positions are single bytes, which 8-bit AVR
+reads and writes atomically; larger buffers use 16-bit positions that are read
+and written with interrupts briefly disabled on AVR.
+
+Basic usage:
+	sta::ring_buffer<uint16, 32> samples;
+
+	ISR(ADC_vect) {
+		samples.push(ADC);
+	}
+
+	void loop() {
+		uint16 batch[8];
+		size_t n = samples.pop(batch, 8);
+		...
+	}
+*/
+template <class Ty, size_t N>
+class _STAXXEXPORT ring_buffer {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "ring_buffer capacity must be a power of two");
+	static_assert(N <= 32768, "ring_buffer capacity must fit a 16-bit position");
+public:
+	typedef typename conditional<N <= 128, uint8, uint16>::type index_type;
+public:
+	ring_buffer() : head(0), tail(0) {}
+	ring_buffer(const ring_buffer&) = delete;
+	ring_buffer& operator=(const ring_buffer&) = delete;
+public: // PRODUCER SIDE
+	bool push(const Ty& item) {
+		index_type h = head;
+		if (index_type(h - load(tail)) == N) return false;
+		buffer[h & Mask] = item;
+		store(head, index_type(h + 1));
+		return true;
+	}
+
+	// Pushes as many of the count items as fit, returns how many were pushed
+	size_t push(const Ty* items, size_t count) {
+		index_type h = head;
+		size_t room = N - index_type(h - load(tail));
+		if (count > room) count = room;
+		for (size_t i = 0; i < count; i++)
+			buffer[index_type(h + i) & Mask] = items[i];
+		store(head, index_type(h + count));
+		return count;
+	}
+public: // CONSUMER SIDE
+	bool pop(Ty& out) {
+		index_type t = tail;
+		if (load(head) == t) return false;
+		out = buffer[t & Mask];
+		store(tail, index_type(t + 1));
+		return true;
+	}
+
+	// Pops up to count items into out, returns how many were popped
+	size_t pop(Ty* out, size_t count) {
+		index_type t = tail;
+		size_t available = index_type(load(head) - t);
+		if (count > available) count = available;
+		for (size_t i = 0; i < count; i++)
+			out[i] = buffer[index_type(t + i) & Mask];
+		store(tail, index_type(t + count));
+		return count;
+	}
+
+	// Oldest item without copying it out, nullptr when empty. Release it with drop()
+	const Ty* peek() const {
+		index_type t = tail;
+		if (load(head) == t) return nullptr;
+		return &buffer[t & Mask];
+	}
+
+	// Oldest items that are contiguous in memory, returns their count (0 when empty)
+	size_t peek_block(const Ty*& first) const {
+		index_type t = tail;
+		size_t available = index_type(load(head) - t);
+		size_t untilWrap = N - (t & Mask);
+		first = &buffer[t & Mask];
+		return available < untilWrap ? available : untilWrap;
+	}
+
+	// Discards up to count of the oldest items
+	void drop(size_t count = 1) {
+		index_type t = tail;
+		size_t available = index_type(load(head) - t);
+		if (count > available) count = available;
+		store(tail, index_type(t + count));
+	}
+public: // EITHER SIDE
+	size_t size() const { return index_type(load(head) - load(tail)); }
+	bool empty() const { return load(head) == load(tail); }
+	bool full() const { return size() == N; }
+	static constexpr size_t capacity() { return N; }
+private:
+	static const index_type Mask = index_type(N - 1);
+
+	static index_type load(const volatile index_type& i) {
+#if defined(__AVR__)
+		// single core: a compiler barrier orders the accesses, only 16-bit reads can tear
+		__asm__ __volatile__("" ::: "memory");
+		if (sizeof(index_type) == 1) return i;
+		uint8 sreg = SREG;
+		cli();
+		index_type v = i;
+		SREG = sreg;
+		return v;
+#else
+		return __atomic_load_n(&i, __ATOMIC_ACQUIRE);
+#endif
+	}
+
+	static void store(volatile index_type& i, index_type v) {
+#if defined(__AVR__)
+		__asm__ __volatile__("" ::: "memory");
+		if (sizeof(index_type) == 1) {
+			i = v;
+			return;
+		}
+		// an interrupt between the two byte writes would read half a position
+		uint8 sreg = SREG;
+		cli();
+		i = v;
+		SREG = sreg;
+#else
+		__atomic_store_n(&i, v, __ATOMIC_RELEASE);
+#endif
+	}
+private:
+	Ty buffer[N];
+	volatile index_type head;	// written by the producer only
+	volatile index_type tail;	// written by the consumer only
+};
 
 template <typename T, size_t N>
 class _STAXXEXPORT array {
@@ -208,6 +592,98 @@ public:
 	inline typename array_traits<T>::const_reference operator[](size_t i) const { return _data[i]; }
 };
 
+/*
+Fixed-size set of N bits packed in machine words.
+
+The find functions skip whole empty (or full) words and locate the bit inside a
+word with count-trailing-zeros, so scanning costs O(words) instead of O(bits).
+They return N when no bit qualifies.
+
+Basic usage:
+	sta::bitset<40> ready;
+	ready.set(3);
+	ready.set(35);
+	for (size_t i = ready.find_first(); i < ready.size(); i = ready.find_next(i))
+		...
+*/
+template <size_t N>
+class _STAXXEXPORT bitset {
+public:
+	typedef unsigned int word_type;
+public:
+	bitset() _STAXX_NOEXCEPT { reset(); }
+public:
+	void set(size_t i) _STAXX_NOEXCEPT { words[i / WordBits] |= bit_mask(i); }
+	void reset(size_t i) _STAXX_NOEXCEPT { words[i / WordBits] &= ~bit_mask(i); }
+	bool test(size_t i) const _STAXX_NOEXCEPT { return (words[i / WordBits] & bit_mask(i)) != 0; }
+
+	void reset() _STAXX_NOEXCEPT {
+		for (size_t w = 0; w < Words; w++) words[w] = 0;
+	}
+
+	bool any() const _STAXX_NOEXCEPT {
+		for (size_t w = 0; w < Words; w++)
+			if (words[w]) return true;
+		return false;
+	}
+
+	bool none() const _STAXX_NOEXCEPT { return !any(); }
+
+	size_t count() const _STAXX_NOEXCEPT {
+		size_t n = 0;
+		for (size_t w = 0; w < Words; w++) n += __builtin_popcount(words[w]);
+		return n;
+	}
+
+	static constexpr size_t size() { return N; }
+public:
+	// Index of the lowest set bit
+	size_t find_first() const _STAXX_NOEXCEPT { return scan(0, ~word_type(0)); }
+
+	// Index of the lowest set bit above i
+	size_t find_next(size_t i) const _STAXX_NOEXCEPT {
+		if (++i >= N) return N;
+		return scan(i / WordBits, ~word_type(0) << (i % WordBits));
+	}
+
+	// Index of the lowest clear bit
+	size_t find_first_unset() const _STAXX_NOEXCEPT {
+		for (size_t w = 0; w < Words; w++) {
+			word_type free = ~words[w];
+			if (free) {
+				size_t i = w * WordBits + __builtin_ctz(free);
+				return i < N ? i : N;
+			}
+		}
+		return N;
+	}
+public:
+	inline bool operator[](size_t i) const { return test(i); }
+	bool operator==(const bitset& other) const {
+		for (size_t w = 0; w < Words; w++)
+			if (words[w] != other.words[w]) return false;
+		return true;
+	}
+	bool operator!=(const bitset& other) const { return !(*this == other); }
+private:
+	static constexpr size_t WordBits = sizeof(word_type) * 8;
+	static constexpr size_t Words = N ? (N + WordBits - 1) / WordBits : 1;
+
+	static word_type bit_mask(size_t i) { return word_type(1) << (i % WordBits); }
+
+	// First set bit from word w on, the bits of word w outside mask are ignored
+	size_t scan(size_t w, word_type mask) const {
+		word_type bits = words[w] & mask;
+		for (;;) {
+			if (bits) return w * WordBits + __builtin_ctz(bits);
+			if (++w >= Words) return N;
+			bits = words[w];
+		}
+	}
+private:
+	word_type words[Words];
+};
+
 END_NP_BLOCK
 
 #endif
\ No newline at end of file
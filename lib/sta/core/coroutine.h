@@ -76,9 +76,16 @@
   Since it's declared as COROUTINE_LOCAL, after returning from the YIELD, its
   value will be restored to what it was prior to yielding.
   COROUTINE_LOCAL declarations must be done before BEGIN_COROUTINE.
-  Coroutine locals live on the heap, so their size must be kept in check. Also,
-  there is a maximum amount of them which defaults to 8, but can be tweaked in
-  this header. (see Coroutine::MaxLocals)
+  Coroutine locals never touch the heap, every coroutine slot owns a small arena
+  they are carved out of in declaration order, which costs nothing to give back
+  when the coroutine ends. The arena holds STA_COROUTINE_LOCAL_BYTES bytes (16 by
+  default, define it before including this header), a manager may use smaller
+  arenas with its second template argument :
+
+    sta::coroutines<4, 8> coroutines; // 4 coroutines with 8 bytes of locals each
+
+  A local larger than STA_COROUTINE_LOCAL_BYTES does not compile, locals that
+  together overflow the arena of their slot trip the assert and abort.
 
   Coroutines may also loop instead of evaluate once, using the loop() function :
 
@@ -163,9 +170,100 @@
   alive for more than 1000ms.
   If used, the COROUTINE_FINALLY block must be placed before END_COROUTINE.
 
+  Only runnable coroutines cost time in update(): a coroutine that waits is parked
+  in a queue sorted by wake-up time and a suspended one is not looked at at all,
+  so dozens of slow coroutines do not slow down the loop. next_wakeup() tells when
+  the earliest of them has to run again, so the sketch knows how long it may idle :
+
+    unsigned long deadline;
+    if (coroutines.next_wakeup(deadline) && !sta::coroutine_due(deadline, sta::coroutine_clock()))
+        ... // nothing to do until deadline
+
+  With the framework, an app whose work all runs in coroutines hands idle_micros()
+  to it, and the loop sleeps until then (see idle.h) :
+
+    unsigned long idleMicros() override { return coroutines.idle_micros(); }
+
+  Coroutines keep time in milliseconds by default, read from sta::loop_clock (see
+  clock.h), so with the framework all of a loop iteration sees the same time and
+  millis() is read once. For sub-millisecond work such as stepper pulses, define
+  STA_COROUTINE_TICK_US as 1 before including this header: the manager then runs
+  on micros() and wait_us() is exact, while wait() and the timeouts keep taking
+  milliseconds. Times are compared through their difference,
+  so the clock wrapping around (every 49.7 days with millis(), 71.6 minutes with
+  micros()) does not disturb the schedule. A single wait may however not exceed
+  half of that period. Times the manager hands out or takes, like update(now) and
+  next_wakeup(), are in ticks of that clock, see coroutine_clock().
+
+  By default the coroutines that are due run in the order of their slots. A coroutine
+  that must not sit behind slower ones gets a higher priority, those of the highest
+  priority run first :
+
+    coroutines.start(pidCompute).setPriority(2);
+
+  A coroutine may also get a deadline, the most milliseconds its runs may end past
+  the time it became due. Each run ending later counts as a deadline miss, for the
+  coroutine and for the whole manager, so an overloaded loop shows up. The end of a
+  run is read from coroutine_clock_live(), so a run that itself takes too long
+  counts as well as one that started late :
+
+    coroutines.start(pidCompute).setDeadline(5);
+    ...
+    if (coroutines.deadline_misses() > 0)
+        ... // some coroutine did not get its turn in time
+
+  With set_policy(sta::coroutine_policy::EarliestDeadline), the coroutines with a
+  deadline run first, the one whose deadline is nearest first, and the others
+  follow by priority.
+
+  A coroutine that waits for something to happen rather than for some time blocks on
+  a sta::event, and costs nothing in update() until the event is signalled :
+
+    sta::event buttonPressed;
+
+    void onButton() // interrupt handler
+    {
+        buttonPressed.signal();
+    }
+
+    void handleButton(COROUTINE_CONTEXT(coroutine))
+    {
+        BEGIN_COROUTINE;
+
+        coroutine.wait_event(buttonPressed, 5000);
+        COROUTINE_YIELD;
+
+        if (coroutine.isTimedOut())
+            Serial.println("No press within 5s");
+
+        coroutine.loop();
+
+        END_COROUTINE;
+    }
+
+  signal() may be called from interrupt handlers, the sketch or other coroutines, and
+  wakes every coroutine blocked on the event at the next update(). When nobody waits,
+  the event stays signalled and the next wait_event() returns on the next update
+  without blocking. Signals that arrive before the waiters run again are merged into one.
+
   There is currently no way to return something from a coroutine or to pass a parameter
   to a coroutine. However, they have access to the sketch's file-scope variables,
-  which can be used for input and/or output.
+  which can be used for input and/or output. Coroutines that hand data to each other
+  can use a sta::channel (channel.h) instead, and block until there is something to
+  read or room to write. With a C++20 compiler, sta::task (task.h) offers coroutines
+  with parameters, return values and plain local variables, which are started in the
+  same manager.
+
+  To find out which coroutine eats the loop's time, define STA_COROUTINE_PROFILING
+  before including this header. Every slot then counts its runs, the microseconds
+  spent in them and how many ticks late it was woken past its wait, and dump_profile() prints
+  the table of the active coroutines through sta::logs :
+
+    id runs avg_us max_us total_us max_late misses
+    0 1520 12 48 18240 1 0
+    1 31 2210 2260 68510 3 2
+
+  Without the define, none of this is compiled in.
 
   The library comes with debug-logging ability, which can be enabled by defining
   three macros :
@@ -194,6 +292,20 @@
   1.2 (2023-05-13)
   - Fixed some bugs withing coroutine
   - Compatibility change with sta
+
+  1.3
+  - Added a C++20 backend, sta::task in task.h, that runs in the same manager
+  - Waiting coroutines sleep in a deadline-ordered queue, update() only runs runnable ones
+  - Added next_wakeup()
+  - Active and runnable coroutines are tracked in bitsets, lifting the limit of 32 coroutines
+  - Coroutine locals live in a fixed arena per slot instead of the heap
+  - Added sta::event and wait_event(), blocking a coroutine until the event is signalled
+  - Added sta::channel in channel.h, with the COROUTINE_SEND and COROUTINE_RECV macros
+  - Optional per-coroutine profiling (STA_COROUTINE_PROFILING) and dump_profile()
+  - Added wait_us() and the micros() time base (STA_COROUTINE_TICK_US)
+  - Deadlines survive the wrap-around of millis() and micros()
+  - Added priorities, deadlines with miss counting and the earliest deadline first policy
+  - Added idle_micros() for the framework's idle
 */
 
 #ifndef COROUTINES_H
@@ -202,12 +314,58 @@
 // The Arduino header is primarily required for use of the millis() function
 #include "Arduino.h"
 
-#define COROUTINES_VERSION 1.2
+#define COROUTINES_VERSION 1.3
 
 #include "sta.h"
+#include "containers.h"
+#include "clock.h"
+
+// Bytes of coroutine locals a slot holds at most, see COROUTINE_LOCAL
+#ifndef STA_COROUTINE_LOCAL_BYTES
+#define STA_COROUTINE_LOCAL_BYTES 16
+#endif
+
+// Microseconds per tick of the coroutines' clock: 1000 runs them on millis(),
+// 1 on micros() for sub-millisecond waits
+#ifndef STA_COROUTINE_TICK_US
+#define STA_COROUTINE_TICK_US 1000
+#endif
+
+#ifdef STA_COROUTINE_PROFILING
+#include "../log.h"
+#endif
 
 BEGIN_NP_BLOCK
 
+static_assert(STA_COROUTINE_TICK_US == 1000 || STA_COROUTINE_TICK_US == 1,
+              "STA_COROUTINE_TICK_US must be 1000 (millis) or 1 (micros)");
+
+// Current time of the coroutines' clock, in ticks of STA_COROUTINE_TICK_US microseconds.
+// Milliseconds come from the framework's loop_clock, so they hold still during a loop iteration.
+inline unsigned long coroutine_clock() {
+#if STA_COROUTINE_TICK_US == 1
+    return micros();
+#else
+    return (unsigned long) loop_clock::now();
+#endif
+}
+
+// The coroutines' clock read right now. Unlike coroutine_clock(), it moves on during a loop
+// iteration, so it tells how long the coroutines ran.
+inline unsigned long coroutine_clock_live() {
+#if STA_COROUTINE_TICK_US == 1
+    return micros();
+#else
+    return (unsigned long) loop_clock::read();
+#endif
+}
+
+// Whether time has come at now. Compares the difference, which stays right when the 32-bit
+// clock wraps around as long as both are less than half its range apart.
+inline bool coroutine_due(unsigned long time, unsigned long now) {
+    return (int32_t) (uint32_t) (now - time) >= 0;
+}
+
 // Debugging macros, null operations unless defined prior to including this .h
 // trace should be : printf(__VA_ARGS__) 
 // or : printf_P(__VA_ARGS__) // if P is defined
@@ -228,24 +386,15 @@ BEGIN_NP_BLOCK
 #define COROUTINE_CONTEXT(coroutine)                            \
 coroutine_interface& coroutine)                                           \
 {                                                               \
-    byte COROUTINE_localIndex = 0;                              \
-    (void) COROUTINE_localIndex;                                \
     coroutine_impl& COROUTINE_ctx = (coroutine_impl&) coroutine;  \
+    COROUTINE_ctx.localsUsed = 0;                               \
     (void) coroutine;                                           \
     if (true
 
-#define COROUTINE_LOCAL(type, name)                                                        \
-    if (COROUTINE_ctx.jumpLocation == 0 && !COROUTINE_ctx.looping)                         \
-    {                                                                                      \
-        assert(COROUTINE_ctx.numSavedLocals >= CoroutineImpl::MaxLocals,                   \
-               P("Ran out of coroutine locals! Increase Coroutine::MaxLocals"));           \
-        trace(P("Allocating local '" #name "' (#%hhu)"), COROUTINE_ctx.numSavedLocals);    \
-        COROUTINE_localIndex = COROUTINE_ctx.numSavedLocals;                               \
-        COROUTINE_ctx.savedLocals[COROUTINE_ctx.numSavedLocals++] = malloc(sizeof(type));  \
-    }                                                                                      \
-    else                                                                                   \
-        COROUTINE_localIndex = COROUTINE_ctx.numRecoveredLocals++;                         \
-    type& name = *((type*) COROUTINE_ctx.savedLocals[COROUTINE_localIndex]);
+#define COROUTINE_LOCAL(type, name)                                                         \
+    static_assert(sizeof(type) <= STA_COROUTINE_LOCAL_BYTES,                                \
+                  "Coroutine local '" #name "' is larger than STA_COROUTINE_LOCAL_BYTES");  \
+    type& name = *static_cast<type*>(COROUTINE_ctx.local(sizeof(type), alignof(type)));
 
 #define BEGIN_COROUTINE                                             \
     trace(P("Entering coroutine #%hhu ('%s') at %lu ms"),           \
@@ -257,7 +406,6 @@ coroutine_interface& coroutine)                                           \
 
 #define COROUTINE_YIELD                         \
         COROUTINE_ctx.jumpLocation = __LINE__;  \
-        COROUTINE_ctx.numRecoveredLocals = 0;   \
         trace(P("...yielding..."));             \
         return;                                 \
     case __LINE__:	
@@ -275,6 +423,8 @@ coroutine_interface& coroutine)                                           \
     return;                                             \
 }
 
+class event;
+
 // Coroutine context object
 // Provides functions for manipulating the execution of coroutines from within
 // a coroutine or from the sketch.
@@ -283,6 +433,12 @@ class _STAXXEXPORT coroutine_interface
 public:
     // Sets the time in milliseconds to wait before the coroutine can come back from a yield
     virtual void wait(unsigned long millis) = 0;
+    // Same as above in microseconds, rounded up to whole ticks of the coroutines' clock
+    virtual void wait_us(unsigned long micros) = 0;
+    // Blocks the coroutine after its next yield until the event is signalled
+    virtual void wait_event(event& ev) = 0;
+    // Same as above, giving up after the time in milliseconds, see isTimedOut()
+    virtual void wait_event(event& ev, unsigned long timeout) = 0;
     // Stops the coroutine on its next update
     virtual void terminate() = 0;
     // Suspends the coroutine indefinitely starting from the next update, pausing its execution
@@ -296,26 +452,173 @@ public:
     virtual bool isTerminated() const = 0;
     // returns true if the coroutine is suspended
     virtual bool isSuspended() const = 0;
+    // returns true if the last wait_event() ended because its timeout ran out
+    virtual bool isTimedOut() const = 0;
+
+    // Sets the priority, coroutines due at the same time run from the highest priority down
+    virtual void setPriority(byte priority) = 0;
+    // Sets the milliseconds within which each run must end after the coroutine became due,
+    // 0 for none
+    virtual void setDeadline(unsigned long millis) = 0;
+    // returns the number of runs that ended past the deadline
+    virtual unsigned int deadlineMisses() const = 0;
+};
+
+// Order in which coroutines<N>::update() runs the coroutines that are due
+enum class
+_STAXXEXPORT coroutine_policy : byte {
+    // Highest priority first, then slot order
+    Priority,
+    // Nearest deadline first, then the coroutines without a deadline by priority
+    EarliestDeadline
 };
 
 // Delegate type of coroutine functions
 typedef void (*coroutineBody)(coroutine_interface&);
 
+class coroutine_impl;
+
+// Non-template part of the coroutines<N> manager.
+// A coroutine whose state is changed from the outside (wait, terminate, suspend, resume
+// called by the sketch or another coroutine) hands itself to reschedule(), so the manager
+// can move it between its ready set and its sleep queue.
+class _STAXXEXPORT coroutine_scheduler
+{
+public:
+    // Marks the end of the sleep queue
+    const static byte None = 0xFF;
+
+    virtual void reschedule(coroutine_impl& coroutine) = 0;
+};
+
+// Something coroutines can block on with wait_event(), see the top of this file.
+// signal() only sets two flags, so it is safe in interrupt handlers. The manager's
+// update() picks the signalled events up and only then touches the waiters.
+class _STAXXEXPORT event
+{
+public:
+    event() : waiters(NULL), nextArmed(NULL), signalled(false), armed(false) {}
+
+    // Wakes the coroutines blocked on this event at the next update
+    void signal() {
+        this->signalled = true;
+        pending() = true;
+    }
+
+    // returns true if the event was signalled and nobody consumed it yet
+    bool isSignalled() const {
+        return this->signalled;
+    }
+
+    // Forgets a signal nobody waited for
+    void clear() {
+        this->signalled = false;
+    }
+
+public: // MANAGER INTERFACE
+    // Set by signal(), tells the managers that some event needs dispatching
+    static volatile bool& pending() {
+        static volatile bool flag = false;
+        return flag;
+    }
+
+    // Wakes the waiters of every signalled event, called at the start of update()
+    static void dispatch();
+
+    // Takes a signal nobody waited for, returns false if there is none
+    bool consume() {
+        if (!this->signalled)
+            return false;
+        this->signalled = false;
+        return true;
+    }
+
+    // Blocks a coroutine on the event
+    void add(coroutine_impl& coroutine);
+    // Gives up waiting, on a timeout or termination
+    void remove(coroutine_impl& coroutine);
+
+private:
+    // Events with waiters, only these are looked at by dispatch()
+    static event*& armedList() {
+        static event* head = NULL;
+        return head;
+    }
+
+    void disarm() {
+        event** link = &armedList();
+        while (*link != this)
+            link = &(*link)->nextArmed;
+        *link = this->nextArmed;
+        this->armed = false;
+    }
+
+    // The blocked coroutines, linked through coroutine_impl::nextWaiter
+    coroutine_impl* waiters;
+    event* nextArmed;
+    volatile bool signalled;
+    bool armed;
+};
+
+#ifdef STA_COROUTINE_PROFILING
+// Run time statistics of a coroutine, see STA_COROUTINE_PROFILING
+struct _STAXXEXPORT coroutine_profile {
+    // Times the coroutine was run
+    unsigned long runs;
+    // Microseconds spent in the coroutine, in total and in its longest run
+    unsigned long totalMicros, maxMicros;
+    // Most ticks it ran after the end of its wait
+    unsigned long maxLateness;
+
+    void reset() {
+        this->runs = 0;
+        this->totalMicros = 0;
+        this->maxMicros = 0;
+        this->maxLateness = 0;
+    }
+
+    void record(unsigned long micros, unsigned long lateness) {
+        this->runs++;
+        this->totalMicros += micros;
+        if (micros > this->maxMicros)
+            this->maxMicros = micros;
+        if (lateness > this->maxLateness)
+            this->maxLateness = lateness;
+    }
+};
+#endif
+
 // Internal class for coroutines, which implements the public abstract one
 class _STAXXEXPORT coroutine_impl : public coroutine_interface
 {
 public:
-    // Maximum number of coroutine locals, increase/decrease if needed
-    const static byte MaxLocals = 8;
-
     coroutineBody function;
+    coroutine_scheduler* scheduler;
+    // Suspended frame of a C++20 task (see task.h), unused by classic coroutines
+    void* frame;
     unsigned long barrierTime, sinceStarted, startedAt, suspendedAt;
     byte id;
-    bool terminated, suspended, looping;
+    // Next coroutine in the manager's sleep queue
+    byte nextSleeper;
+    bool terminated, suspended, looping, sleeping;
+    // Whether the last wait_event() timed out, and whether the current one has no timeout
+    bool timedOut, waitForever;
+    // Scheduling order, see coroutine_policy
+    byte priority;
+    // Ticks a run may end after the coroutine became due, 0 without a deadline
+    unsigned long deadline;
+    unsigned int missedDeadlines;
+    // The event the coroutine is blocked on and the next coroutine blocked on it
+    event* waitingOn;
+    coroutine_impl* nextWaiter;
     long jumpLocation;
-    // Coroutine locals are heap-allocated on demand and freed on termination
-    void* savedLocals[MaxLocals];
-    byte numSavedLocals, numRecoveredLocals;
+#ifdef STA_COROUTINE_PROFILING
+    coroutine_profile profile;
+#endif
+    // Arena of the coroutine locals, owned by the manager
+    byte* locals;
+    // Size of the arena and bytes taken by the locals declared so far on this entry
+    byte localsSize, localsUsed;
 
 public:
     // Resets the coroutine's state, used when recycling coroutine objects
@@ -325,56 +628,99 @@ public:
         this->jumpLocation = 0;
         this->terminated = suspended = false;
         this->function = NULL;
-        this->numSavedLocals = 0;
-        this->numRecoveredLocals = 0;
+        this->frame = NULL;
+        this->localsUsed = 0;
         this->terminated = false;
         this->suspended = false;
         this->looping = false;
+        this->sleeping = false;
+        this->timedOut = false;
+        this->waitForever = false;
+        this->waitingOn = NULL;
+        this->nextWaiter = NULL;
+        this->priority = 0;
+        this->deadline = 0;
+        this->missedDeadlines = 0;
+        this->nextSleeper = coroutine_scheduler::None;
+#ifdef STA_COROUTINE_PROFILING
+        this->profile.reset();
+#endif
     }
 
-    // frees coroutine locals when it's terminated
-    void freeLocals() {
-        if (this->numSavedLocals == 0)
+    // Stops waiting for an event, if the coroutine does
+    void cancelWait() {
+        if (this->waitingOn == NULL)
             return;
-
-        trace(P("Freeing %hhu local(s)"), this->numSavedLocals);
-        for (int i = 0; i < this->numSavedLocals; i++)
-            free(this->savedLocals[i]);
-        this->numSavedLocals = 0;
+        this->waitingOn->remove(*this);
+        this->waitingOn = NULL;
     }
 
-    bool update(unsigned long millis) {
-        if (this->suspended)
-            return false;
-
-        if (this->barrierTime <= millis)
-        {
-            this->sinceStarted = this->startedAt > millis ? 0 : millis - this->startedAt;
-            this->function(*this);
-            return terminated;
-        }
+    // Storage of the next coroutine local, locals are laid out in declaration order so
+    // every entry into the coroutine finds them at the same place
+    void* local(size_t size, size_t align) {
+        size_t start = (this->localsUsed + align - 1) & ~(align - 1);
+        assert(start + size <= this->localsSize, P("Ran out of coroutine locals! Increase the local bytes of coroutines<N>"));
+        if (start + size > this->localsSize)
+            abort();
+        this->localsUsed = (byte) (start + size);
+        return this->locals + start;
+    }
 
-        return false;
+    // Runs the coroutine until its next yield, the manager only calls it when it is due
+    // returns true when the coroutine terminated
+    bool run(unsigned long now) {
+        this->sinceStarted = coroutine_due(this->startedAt, now) ? now - this->startedAt : 0;
+#ifdef STA_COROUTINE_PROFILING
+        unsigned long lateness = coroutine_due(this->barrierTime, now) ? now - this->barrierTime : 0;
+        unsigned long began = micros();
+        this->function(*this);
+        this->profile.record(micros() - began, lateness);
+#else
+        this->function(*this);
+#endif
+        // a yield without wait() is due again right away
+        if (coroutine_due(this->barrierTime, now))
+            this->barrierTime = now;
+        return terminated;
     }
 
 public:
     void wait(unsigned long time) override {
-        this->barrierTime = millis() + time;
+        this->cancelWait();
+        this->barrierTime = coroutine_clock() + ticks(time);
+        this->scheduler->reschedule(*this);
+    }
+
+    void wait_us(unsigned long time) override {
+        this->cancelWait();
+        this->barrierTime = coroutine_clock() + (time + STA_COROUTINE_TICK_US - 1) / STA_COROUTINE_TICK_US;
+        this->scheduler->reschedule(*this);
+    }
+
+    void wait_event(event& ev) override {
+        this->block(ev, 0, true);
+    }
+
+    void wait_event(event& ev, unsigned long timeout) override {
+        this->block(ev, timeout, false);
     }
 
     void terminate() override {
+        this->cancelWait();
         this->terminated = true;
         this->suspended = false;
         this->looping = false;
         this->jumpLocation = -1;
         this->barrierTime = 0;
+        this->scheduler->reschedule(*this);
     }
 
     void suspend() override {
         if (!this->suspended && !this->terminated)
         {
             this->suspended = true;
-            this->suspendedAt = millis();
+            this->suspendedAt = coroutine_clock();
+            this->scheduler->reschedule(*this);
         }
     }
 
@@ -382,13 +728,13 @@ public:
         if (this->suspended && !this->terminated)
         {
             this->suspended = false;
-            this->startedAt += millis() - this->suspendedAt;
+            this->startedAt += coroutine_clock() - this->suspendedAt;
+            this->scheduler->reschedule(*this);
         }
     }    
     
     void loop() override {
         this->jumpLocation = 0;
-        this->numRecoveredLocals = 0;
         this->looping = true;
         trace(P("...looping..."));
     }
@@ -400,97 +746,367 @@ public:
     inline bool isSuspended() const override {
         return this->suspended;
     }
+
+    inline bool isTimedOut() const override {
+        return this->timedOut;
+    }
+
+    void setPriority(byte priority) override {
+        this->priority = priority;
+    }
+
+    void setDeadline(unsigned long time) override {
+        this->deadline = ticks(time);
+    }
+
+    inline unsigned int deadlineMisses() const override {
+        return this->missedDeadlines;
+    }
+
+private:
+    // Ticks of the coroutines' clock in the given milliseconds
+    static unsigned long ticks(unsigned long millis) {
+        return millis * (1000 / STA_COROUTINE_TICK_US);
+    }
+
+    void block(event& ev, unsigned long timeout, bool forever) {
+        this->cancelWait();
+        this->timedOut = false;
+        this->barrierTime = coroutine_clock();
+        if (!ev.consume())
+        {
+            // not signalled yet, park until it is (or until the timeout)
+            this->waitingOn = &ev;
+            this->waitForever = forever;
+            this->barrierTime += ticks(timeout);
+            ev.add(*this);
+        }
+        this->scheduler->reschedule(*this);
+    }
 };
 
+inline void event::dispatch() {
+    if (!pending())
+        return;
+    pending() = false;
+
+    event** link = &armedList();
+    while (*link != NULL)
+    {
+        event& ev = **link;
+        if (!ev.consume())
+        {
+            link = &ev.nextArmed;
+            continue;
+        }
+
+        // detach the waiters first, waking one may make it wait on this event again
+        *link = ev.nextArmed;
+        ev.armed = false;
+        coroutine_impl* coroutine = ev.waiters;
+        ev.waiters = NULL;
+        while (coroutine != NULL)
+        {
+            coroutine_impl* next = coroutine->nextWaiter;
+            coroutine->waitingOn = NULL;
+            coroutine->nextWaiter = NULL;
+            coroutine->barrierTime = coroutine_clock();
+            coroutine->scheduler->reschedule(*coroutine);
+            coroutine = next;
+        }
+    }
+}
+
+inline void event::add(coroutine_impl& coroutine) {
+    coroutine.nextWaiter = this->waiters;
+    this->waiters = &coroutine;
+    if (!this->armed)
+    {
+        this->nextArmed = armedList();
+        armedList() = this;
+        this->armed = true;
+    }
+}
+
+inline void event::remove(coroutine_impl& coroutine) {
+    coroutine_impl** link = &this->waiters;
+    while (*link != NULL && *link != &coroutine)
+        link = &(*link)->nextWaiter;
+    if (*link != NULL)
+        *link = coroutine.nextWaiter;
+    coroutine.nextWaiter = NULL;
+    if (this->waiters == NULL && this->armed)
+        this->disarm();
+}
+
 // Coroutines manager class
 // The N template argument determines how many coroutines are allocated, which is to say
-// how many coroutines can be active at once. Since an 32-bit mask is used to track active
-// coroutines, the maximum value for N is 32, not 255.
-template <byte N>
-class _STAXXEXPORT coroutines {
+// how many coroutines can be active at once, up to 254.
+// LocalBytes is the size of the arena of coroutine locals every slot owns.
+// Active and runnable coroutines are tracked in two bitsets that are scanned a word at a
+// time, waiting ones in a queue sorted by barrierTime, so update() never looks at a
+// coroutine that is not due. The due ones are ordered by the coroutine_policy first.
+template <byte N, size_t LocalBytes = STA_COROUTINE_LOCAL_BYTES>
+class _STAXXEXPORT coroutines : public coroutine_scheduler {
+    static_assert(N > 0 && N < None, "coroutines<N> supports 1 to 254 coroutines");
+    static_assert(LocalBytes <= STA_COROUTINE_LOCAL_BYTES && LocalBytes < 256,
+                  "LocalBytes must not exceed STA_COROUTINE_LOCAL_BYTES, nor 255");
+    // arenas start aligned for any local
+    static constexpr size_t LocalStride = (LocalBytes + alignof(max_align) - 1) / alignof(max_align) * alignof(max_align);
 private:
     // The coroutine context objects
-    coroutine_impl coroutines[N];
-    // bitmask tracking the number of active coroutines
-    unsigned long activeMask;
+    coroutine_impl slots[N];
+    // the started coroutines that did not terminate yet
+    bitset<N> active;
+    // the active coroutines that run on the next update
+    bitset<N> ready;
     // The count of active coroutines
     byte activeCount;
+    // Id of the sleeping coroutine that wakes up first, None when nobody sleeps
+    byte sleepHead;
+    // The coroutine update() is running right now, it is rescheduled once it yields
+    coroutine_impl* running;
+    // The ids of the coroutines update() runs, in the order it runs them
+    byte runOrder[N];
+    coroutine_policy policy;
+    // Runs of all coroutines that ended past their deadline
+    unsigned long missedDeadlines;
+    // The arenas of the coroutine locals, one per slot
+    alignas(max_align) byte localStorage[LocalStride * N + 1];
 
 public:
     coroutines() 
-        : activeMask(0),
-        activeCount(0)
+        : activeCount(0),
+        sleepHead(None),
+        running(NULL),
+        policy(coroutine_policy::Priority),
+        missedDeadlines(0)
     {
         // ids are assigned sequentially and never change
         for (byte i = 0; i < N; i++)
-            this->coroutines[i].id = i;
+        {
+            this->slots[i].id = i;
+            this->slots[i].scheduler = this;
+            this->slots[i].locals = this->localStorage + i * LocalStride;
+            this->slots[i].localsSize = LocalBytes;
+        }
     }
 
     // Starts a coroutine
     // The function parameter is the name of the coroutine's function.
     // The coroutine's context object is returned by reference so it can be manipulated from the sketch.
     coroutine_impl& start(coroutineBody function) {
-        for (byte i = 0; i < min(N, sizeof(unsigned long) * 8); i++)
-            // take the first inactive slot
-            if (!bitRead(activeMask, i))
-            {
-                // mark as active
-                bitSet(activeMask, i);
-                activeCount++;
-
-                trace(P("Adding coroutine #%hhu"), i);
-                coroutine_impl& coroutine = coroutines[i];
-                // reset state of the context object on start
-                coroutine.reset();
-                coroutine.function = function;
-                // remember the time it starts at
-                coroutine.startedAt = millis();
-
-                return coroutine;
-            }
+        // take the first inactive slot
+        size_t i = active.find_first_unset();
+        if (i < N)
+        {
+            // mark as active and runnable
+            active.set(i);
+            ready.set(i);
+            activeCount++;
+
+            trace(P("Adding coroutine #%hhu"), (byte) i);
+            coroutine_impl& coroutine = slots[i];
+            // reset state of the context object on start
+            coroutine.reset();
+            coroutine.function = function;
+            // remember the time it starts at, it is due right away
+            coroutine.startedAt = coroutine_clock();
+            coroutine.barrierTime = coroutine.startedAt;
+
+            return coroutine;
+        }
 
         // out of coroutines!
         assert(false, P("Out of allocated coroutines!"));
         abort(); // to avoid compile warning
     }
 
+    // Starts a C++20 sta::task (see task.h), the manager takes over the task's frame
+    template <class Task>
+    coroutine_impl& start(Task&& task, typename remove_reference<Task>::type::promise_type* = NULL) {
+        coroutine_impl& coroutine = start(&remove_reference<Task>::type::trampoline);
+        coroutine.frame = task.release(coroutine);
+        return coroutine;
+    }
+
     // Updates the active coroutines.
-    // Use this overload if you already have called millis() in your loop function and kept the value.
-    void update(unsigned long millis) {
-        int b = 0;
-        int removed = 0;
-        for (int i = 0; i < activeCount; i++)
+    // Use this overload if you already have read coroutine_clock() in your loop function and kept the value.
+    void update(unsigned long now) {
+        // wake the coroutines blocked on signalled events
+        event::dispatch();
+
+        // move the sleepers that are due to the ready set
+        while (sleepHead != None && coroutine_due(slots[sleepHead].barrierTime, now))
         {
-            while (!bitRead(activeMask, b))
+            coroutine_impl& coroutine = slots[sleepHead];
+            sleepHead = coroutine.nextSleeper;
+            coroutine.sleeping = false;
+            if (coroutine.waitingOn != NULL)
             {
-                b++;
-                if (b == N) b = 0;
+                // wait_event() ran out of time
+                coroutine.cancelWait();
+                coroutine.timedOut = true;
             }
+            ready.set(coroutine.id);
+        }
+
+        // coroutines that become ready while this pass runs get their turn on the next update,
+        // insertion sort keeps slot order among equals and is linear when nothing needs ordering
+        byte count = 0;
+        for (size_t b = ready.find_first(); b < N; b = ready.find_next(b))
+        {
+            byte i = count++;
+            for (; i > 0 && runsBefore(slots[b], slots[runOrder[i - 1]]); i--)
+                runOrder[i] = runOrder[i - 1];
+            runOrder[i] = (byte) b;
+        }
 
-            assert(b >= N, P("Couldn't find active coroutine!"));
+        for (byte i = 0; i < count; i++)
+        {
+            byte b = runOrder[i];
+            if (!ready.test(b))
+                continue;
+
+            coroutine_impl& coroutine = slots[b];
+            unsigned long deadline = coroutine.barrierTime + coroutine.deadline;
+            running = &coroutine;
+            bool result = coroutine.run(now);
+            running = NULL;
+
+            // the held clock has not moved since the run began, the live one tells when it ended
+            if (coroutine.deadline != 0 && !coroutine_due(coroutine_clock_live(), deadline))
+            {
+                coroutine.missedDeadlines++;
+                missedDeadlines++;
+            }
 
-            coroutine_impl& coroutine = coroutines[b];
-            bool result = coroutine.update(millis);
+            ready.reset(b);
             if (result)
             {
                 // remove coroutine
-                coroutine.freeLocals();
-                trace(P("Removing coroutine #%hhu"), b);
-                bitClear(activeMask, b);
+                coroutine.cancelWait();
+                trace(P("Removing coroutine #%hhu"), (byte) b);
+                active.reset(b);
                 coroutine.terminated = true;
-                removed++;
+                activeCount--;
             }
-
-            b++;
+            else
+                enqueue(coroutine, now);
         }
-
-        activeCount -= removed;
     }
 
     // Updates the active coroutines.
-    // This overload will call millis() by itself.
+    // This overload will call coroutine_clock() by itself.
     void update() {
-        update(millis());
+        update(coroutine_clock());
+    }
+
+    // Sets the order in which the coroutines that are due run
+    void set_policy(coroutine_policy policy) {
+        this->policy = policy;
+    }
+
+    // Runs of all coroutines that ended past their deadline since the manager was created
+    unsigned long deadline_misses() const {
+        return missedDeadlines;
+    }
+
+    // Earliest time in ticks of coroutine_clock() at which a coroutine has to run, which is now if one
+    // is runnable already. Returns false when every coroutine is suspended or none is active.
+    bool next_wakeup(unsigned long& deadline) const {
+        if (ready.any() || event::pending())
+        {
+            deadline = coroutine_clock();
+            return true;
+        }
+        if (sleepHead == None)
+            return false;
+        deadline = slots[sleepHead].barrierTime;
+        return true;
+    }
+
+    // Microseconds the loop may sleep before a coroutine has to run, 0 when one is runnable
+    // already and ~0UL when all of them wait for events or are suspended.
+    unsigned long idle_micros() const {
+        unsigned long deadline;
+        if (!next_wakeup(deadline))
+            return ~0UL;
+#if STA_COROUTINE_TICK_US == 1
+        uint32_t now = micros();
+        return coroutine_due(deadline, now) ? 0 : (uint32_t) (deadline - now);
+#else
+        // the held loop time is behind by however long this iteration ran
+        return loop_clock::micros_until((uint32_t) deadline);
+#endif
+    }
+
+#ifdef STA_COROUTINE_PROFILING
+    // Prints the profile of every active coroutine, one line each
+    void dump_profile() const {
+        logs(F("id"), F("runs"), F("avg_us"), F("max_us"), F("total_us"), F("max_late"), F("misses"));
+        for (size_t i = active.find_first(); i < N; i = active.find_next(i))
+        {
+            const coroutine_profile& profile = slots[i].profile;
+            logs((unsigned) i, profile.runs, profile.runs ? profile.totalMicros / profile.runs : 0UL,
+                 profile.maxMicros, profile.totalMicros, profile.maxLateness, slots[i].missedDeadlines);
+        }
+    }
+#endif
+
+    void reschedule(coroutine_impl& coroutine) override {
+        // update() decides where the running coroutine goes once it yields
+        if (&coroutine == running || !active.test(coroutine.id))
+            return;
+        unlink(coroutine);
+        enqueue(coroutine, coroutine_clock());
+    }
+
+private:
+    // Whether a runs before b under the current policy
+    bool runsBefore(const coroutine_impl& a, const coroutine_impl& b) const {
+        if (policy == coroutine_policy::EarliestDeadline && (a.deadline != 0 || b.deadline != 0))
+        {
+            if (a.deadline == 0 || b.deadline == 0)
+                return b.deadline == 0;
+            return !coroutine_due(b.barrierTime + b.deadline, a.barrierTime + a.deadline);
+        }
+        return a.priority > b.priority;
+    }
+
+    // Puts a coroutine that is not scheduled yet in the ready set or the sleep queue,
+    // suspended coroutines and those blocked on an event without timeout go nowhere
+    void enqueue(coroutine_impl& coroutine, unsigned long now) {
+        if (coroutine.suspended)
+            return;
+        if (coroutine.waitingOn != NULL && coroutine.waitForever)
+            return;
+        if (coroutine.terminated || coroutine_due(coroutine.barrierTime, now))
+        {
+            ready.set(coroutine.id);
+            return;
+        }
+
+        // sorted insert, equal deadlines keep their insertion order
+        byte* link = &sleepHead;
+        while (*link != None && coroutine_due(slots[*link].barrierTime, coroutine.barrierTime))
+            link = &slots[*link].nextSleeper;
+        coroutine.nextSleeper = *link;
+        coroutine.sleeping = true;
+        *link = coroutine.id;
+    }
+
+    // Takes a coroutine out of the ready set and the sleep queue
+    void unlink(coroutine_impl& coroutine) {
+        ready.reset(coroutine.id);
+        if (!coroutine.sleeping)
+            return;
+
+        byte* link = &sleepHead;
+        while (*link != coroutine.id)
+            link = &slots[*link].nextSleeper;
+        *link = coroutine.nextSleeper;
+        coroutine.sleeping = false;
     }
 };
 
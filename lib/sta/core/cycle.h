@@ -0,0 +1,124 @@
+#ifndef _STA_CYCLE_
+#define _STA_CYCLE_
+
+#include "sta.h"
+
+/*
+Fixed-rate scan cycle, the way a PLC runs its program.
+
+An app that overrides micro_controller::cycleMicros() gets its onUpdate() called
+once per period instead of on every turn of loop(). entry_point.h drives this
+class: due() tells whether the next cycle has come, begin() and end() frame the
+call of onUpdate(). Cycles start on a fixed grid of period microseconds, each one
+is scheduled from where the previous one was due rather than from when it
+started, so late starts do not add up to drift.
+
+    class Plc : public sta::micro_controller {
+        unsigned long cycleMicros() override { return 10000; } // 100Hz
+        bool onUpdate() override {
+            ... // runs every 10ms
+            return true;
+        }
+    };
+
+A cycle still running when the next one is due is an overrun. The cycles it
+covered are dropped and the next one starts on the grid again, instead of a
+burst of cycles catching up.
+
+stats() tells, in microseconds, how late the cycles started (the jitter) and how
+long onUpdate() ran. Between cycles the loop keeps updating the timers and may
+sleep, see idle.h. Times come from micros(), a period must be less than 2^31
+microseconds.
+*/
+
+BEGIN_NP_BLOCK
+
+struct _STAXXEXPORT cycle_stats {
+    unsigned long cycles;
+    // Cycles that ran into the next one
+    unsigned long overruns;
+    // Microseconds the last cycle started late, and the most any did
+    unsigned long lastJitter;
+    unsigned long maxJitter;
+    // Microseconds the last cycle ran, and the longest any did
+    unsigned long lastExec;
+    unsigned long maxExec;
+};
+
+class _STAXXEXPORT loop_cycle {
+public:
+    // Whether the next cycle is due, the first one is right away
+    static bool due() {
+        state& s = get();
+        return !s.started || (int32_t) ((uint32_t) micros() - s.next) >= 0;
+    }
+
+    // Microseconds until the next cycle is due
+    static unsigned long micros_left() {
+        state& s = get();
+        if (!s.started)
+            return 0;
+        int32_t left = (int32_t) (s.next - (uint32_t) micros());
+        return left > 0 ? (unsigned long) left : 0;
+    }
+
+    // Starts a cycle, call once due() returned true
+    static void begin() {
+        state& s = get();
+        s.began = micros();
+        if (!s.started)
+        {
+            s.next = s.began;
+            s.started = true;
+        }
+        unsigned long jitter = s.began - s.next;
+        s.stats.lastJitter = jitter;
+        if (jitter > s.stats.maxJitter)
+            s.stats.maxJitter = jitter;
+    }
+
+    // Ends the cycle begin() started and schedules the next one, period microseconds after this one was due
+    static void end(unsigned long period) {
+        state& s = get();
+        uint32_t now = micros();
+        unsigned long exec = now - s.began;
+        s.stats.cycles++;
+        s.stats.lastExec = exec;
+        if (exec > s.stats.maxExec)
+            s.stats.maxExec = exec;
+
+        s.next += (uint32_t) period;
+        if ((int32_t) (now - s.next) >= 0)
+        {
+            // skip the cycles that should have started meanwhile
+            s.stats.overruns++;
+            s.next += ((now - s.next) / (uint32_t) period + 1) * (uint32_t) period;
+        }
+    }
+
+    static const cycle_stats& stats() { return get().stats; }
+
+    // Clears the stats and starts the next cycle right away, on a new grid
+    static void reset() {
+        state& s = get();
+        s.stats = cycle_stats();
+        s.started = false;
+    }
+private:
+    struct state {
+        cycle_stats stats;
+        // micros() at which the next cycle is due and at which the running one began
+        uint32_t next;
+        uint32_t began;
+        bool started;
+    };
+
+    static state& get() {
+        static state s = { cycle_stats(), 0, 0, false };
+        return s;
+    }
+};
+
+END_NP_BLOCK
+
+#endif
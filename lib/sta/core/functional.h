@@ -2,6 +2,14 @@
 #define _STA_FUNCTIONAL_
 
 #include "sta.h"
+#include "utility.h"
+
+// Placement new, the AVR cores ship it in new.h instead of <new>
+#if defined(__AVR__)
+#include <new.h>
+#else
+#include <new>
+#endif
 
 BEGIN_NP_BLOCK
 
@@ -20,61 +28,211 @@ Example use of sta::function
 
 */
 
+// Bytes a sta::function stores inline before it falls back to the heap
+#ifndef STA_FUNCTION_INLINE_SIZE
+#define STA_FUNCTION_INLINE_SIZE (2 * sizeof(void*))
+#endif
+
 template <typename T>
 class function;
 
 /* 
 Simple lambda function API, to make use of lambdas in c++ easier.
 Derived from std::function<ReturnValue, ... Args>
+
+Callables up to STA_FUNCTION_INLINE_SIZE bytes (function pointers, capture-less
+lambdas and lambdas capturing a pointer or two) are stored inside the function
+itself, only bigger ones are allocated on the heap. Copying a function copies the
+callable, moving it steals the callable and leaves the source empty.
 */
 template <typename ReturnValue, typename... Args>
 class _STAXXEXPORT 
 function<ReturnValue(Args...)> {
 public: // CON-/DESTRUCTORS
-    template <typename T>
-    function(T t) {
-        callable_ = new CallableT<T>(t);
+    function() _STAXX_NOEXCEPT : ops_(nullptr) {}
+
+    template <typename T, typename = typename enable_if<!is_same<typename decay<T>::type, function>::value>::type>
+    function(T&& t) : ops_(nullptr) {
+        this->assign(sta::forward<T>(t));
+    }
+
+    function(const function& other) : ops_(nullptr) {
+        if (other.ops_) other.ops_->copy(this->storage_, other.storage_);
+        this->ops_ = other.ops_;
+    }
+
+    function(function&& other) _STAXX_NOEXCEPT : ops_(nullptr) {
+        this->steal(other);
     }
 
     ~function() {
-        if (callable_ == nullptr) delete callable_;
+        this->reset();
     }
 public: // OPERATORS 
-    template <typename T>
-    function& operator=(T t) {
-        if (callable_ == nullptr) delete callable_;
-        callable_ = new CallableT<T>(t);
+    template <typename T, typename = typename enable_if<!is_same<typename decay<T>::type, function>::value>::type>
+    function& operator=(T&& t) {
+        this->reset();
+        this->assign(sta::forward<T>(t));
+        return *this;
+    }
+
+    function& operator=(const function& other) {
+        if (this != &other) {
+            this->reset();
+            if (other.ops_) other.ops_->copy(this->storage_, other.storage_);
+            this->ops_ = other.ops_;
+        }
+        return *this;
+    }
+
+    function& operator=(function&& other) _STAXX_NOEXCEPT {
+        if (this != &other) {
+            this->reset();
+            this->steal(other);
+        }
         return *this;
     }
 
     ReturnValue operator()(Args... args) const {
-        return callable_->Invoke(args...);
+        return this->ops_->invoke(this->storage_, sta::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const _STAXX_NOEXCEPT { return this->ops_ != nullptr; }
+public: // HELPERS
+    // Drops the callable, the function is empty afterwards
+    void reset() _STAXX_NOEXCEPT {
+        if (this->ops_) this->ops_->destroy(this->storage_);
+        this->ops_ = nullptr;
     }
 private: // INTERNAL TYPES
-    class ICallable {
-    public:
-        virtual ~ICallable() = default;
-        virtual ReturnValue Invoke(Args...) = 0;
+    union storage {
+        void* object;
+        void (*pointer)();
+        long number;
+        unsigned char bytes[STA_FUNCTION_INLINE_SIZE];
     };
 
-    template <typename T>
-    class CallableT : public ICallable {
-    public:
-        CallableT(const T& t)
-        : t_(t) {
+    struct operations {
+        ReturnValue (*invoke)(storage&, Args&&...);
+        void (*copy)(storage& to, const storage& from);
+        void (*move)(storage& to, storage& from);
+        void (*destroy)(storage&);
+    };
+
+    template <typename T, bool Inline = sizeof(T) <= sizeof(storage) && alignof(T) <= alignof(storage)>
+    struct manager {
+        static T& get(storage& s) { return *reinterpret_cast<T*>(s.bytes); }
+        static const T& get(const storage& s) { return *reinterpret_cast<const T*>(s.bytes); }
+
+        template <typename U>
+        static void create(storage& s, U&& t) { ::new (s.bytes) T(sta::forward<U>(t)); }
+        static ReturnValue invoke(storage& s, Args&&... args) { return get(s)(sta::forward<Args>(args)...); }
+        static void copy(storage& to, const storage& from) { ::new (to.bytes) T(get(from)); }
+        static void move(storage& to, storage& from) {
+            ::new (to.bytes) T(sta::move(get(from)));
+            get(from).~T();
         }
+        static void destroy(storage& s) { get(s).~T(); }
+    };
 
-        ~CallableT() override = default;
+    template <typename T>
+    struct manager<T, false> {
+        static T& get(storage& s) { return *static_cast<T*>(s.object); }
+        static const T& get(const storage& s) { return *static_cast<const T*>(s.object); }
+
+        template <typename U>
+        static void create(storage& s, U&& t) { s.object = new T(sta::forward<U>(t)); }
+        static ReturnValue invoke(storage& s, Args&&... args) { return get(s)(sta::forward<Args>(args)...); }
+        static void copy(storage& to, const storage& from) { to.object = new T(get(from)); }
+        static void move(storage& to, storage& from) { to.object = from.object; }
+        static void destroy(storage& s) { delete static_cast<T*>(s.object); }
+    };
 
-        ReturnValue Invoke(Args... args) override {
-            return t_(args...);
-        }
+    template <typename T>
+    struct table {
+        static const operations ops;
+    };
+private: // INTERNAL METHODS
+    template <typename T>
+    void assign(T&& t) {
+        typedef typename decay<T>::type callable;
+        manager<callable>::create(this->storage_, sta::forward<T>(t));
+        this->ops_ = &table<callable>::ops;
+    }
 
-    private:
-        T t_;
+    void steal(function& other) _STAXX_NOEXCEPT {
+        if (other.ops_) other.ops_->move(this->storage_, other.storage_);
+        this->ops_ = other.ops_;
+        other.ops_ = nullptr;
+    }
+private: // ATTRIBUTES
+    mutable storage storage_;
+    const operations* ops_;
+};
+
+template <typename ReturnValue, typename... Args>
+template <typename T>
+const typename function<ReturnValue(Args...)>::operations function<ReturnValue(Args...)>::table<T>::ops = {
+    &manager<T>::invoke, &manager<T>::copy, &manager<T>::move, &manager<T>::destroy
+};
+
+template <typename T>
+class function_ref;
+
+/*
+Non-owning reference to a callable, for parameters that only call what they are
+given before returning. Two pointers big, never allocates and costs one indirect
+call, but the referenced callable must outlive the function_ref.
+
+Basic usage:
+    void repeat(int times, sta::function_ref<void(int)> body) {
+        for (int i = 0; i < times; i++) body(i);
+    }
+
+    repeat(3, [&](int i) { Serial.println(i); });
+*/
+template <typename ReturnValue, typename... Args>
+class _STAXXEXPORT
+function_ref<ReturnValue(Args...)> {
+public: // CONSTRUCTORS
+    template <typename T>
+    function_ref(T& t) _STAXX_NOEXCEPT : thunk_(&call<T>) {
+        this->target_.object = const_cast<void*>(static_cast<const void*>(&t));
+    }
+
+    template <typename T>
+    function_ref(const T& t) _STAXX_NOEXCEPT : thunk_(&call<const T>) {
+        this->target_.object = const_cast<void*>(static_cast<const void*>(&t));
+    }
+
+    function_ref(ReturnValue (*fn)(Args...)) _STAXX_NOEXCEPT : thunk_(&call_pointer) {
+        this->target_.pointer = fn;
+    }
+
+    function_ref(const function_ref&) = default;
+    function_ref(function_ref& other) _STAXX_NOEXCEPT : target_(other.target_), thunk_(other.thunk_) {}
+    function_ref& operator=(const function_ref&) = default;
+public: // OPERATORS
+    ReturnValue operator()(Args... args) const {
+        return this->thunk_(this->target_, sta::forward<Args>(args)...);
+    }
+private: // INTERNAL TYPES
+    union target {
+        void* object;
+        ReturnValue (*pointer)(Args...);
     };
+private: // INTERNAL METHODS
+    template <typename T>
+    static ReturnValue call(const target& t, Args&&... args) {
+        return (*static_cast<T*>(t.object))(sta::forward<Args>(args)...);
+    }
+
+    static ReturnValue call_pointer(const target& t, Args&&... args) {
+        return t.pointer(sta::forward<Args>(args)...);
+    }
 private: // ATTRIBUTES
-    ICallable* callable_;
+    target target_;
+    ReturnValue (*thunk_)(const target&, Args&&...);
 };
 
 template <class Arg, class Result> struct unary_function;
@@ -0,0 +1,146 @@
+#ifndef _STA_HISTOGRAM_
+#define _STA_HISTOGRAM_
+
+#include "sta.h"
+#include "../log.h"
+
+/*
+Histogram of durations in log2 buckets, small enough to keep running on an AVR.
+
+Bucket 0 counts the zeros and bucket i the values from 2^(i-1) up to 2^i - 1, the
+last bucket also takes everything above. With the default 20 buckets of 16 bits a
+histogram costs 40 bytes for the buckets and about as much for the exact count,
+minimum, maximum, sum and budget overruns next to them. When a bucket is about to
+overflow, every bucket is halved: the shape of the distribution stays, it just
+forgets the oldest samples a little.
+
+percentile() answers from the buckets, so it is the upper end of the bucket the
+percentile falls in, never more than the maximum. Values are meant to be
+microseconds, but any unit works.
+
+Basic usage:
+    sta::log2_histogram<> sends(2000); // 2ms budget
+
+    unsigned long began = micros();
+    send();
+    sends.record(micros() - began);
+    ...
+    sends.dump(F("send us"));          // or sends.percentile(99), sends.overruns(), ...
+
+With STA_LOOP_HISTOGRAM defined, entry_point.h keeps one of these for the
+duration of every loop iteration, see loop_histogram() there.
+*/
+
+BEGIN_NP_BLOCK
+
+template <byte Buckets = 20>
+class _STAXXEXPORT log2_histogram {
+public:
+    static_assert(Buckets >= 2 && Buckets <= 33, "a 32-bit value spans at most 33 buckets");
+public: // CON-/DESTRUCTORS
+    // Values above budget count as overruns, 0 counts none
+    log2_histogram(uint32_t budget = 0) _STAXX_NOEXCEPT : limit(budget) {
+        this->reset();
+    }
+public:
+    void record(uint32_t value) {
+        byte b = bucketOf(value);
+        if (this->buckets[b] == 0xFFFF)
+            this->halve();
+        this->buckets[b]++;
+
+        if (this->samples == 0 || value < this->lowest)
+            this->lowest = value;
+        if (value > this->highest)
+            this->highest = value;
+        this->samples++;
+        this->sum += value;
+        if (this->limit != 0 && value > this->limit)
+            this->over++;
+    }
+
+    void reset() {
+        for (byte b = 0; b < Buckets; b++)
+            this->buckets[b] = 0;
+        this->samples = 0;
+        this->sum = 0;
+        this->lowest = 0;
+        this->highest = 0;
+        this->over = 0;
+    }
+
+    inline uint32_t count() const { return this->samples; }
+    inline uint32_t minimum() const { return this->lowest; }
+    inline uint32_t maximum() const { return this->highest; }
+    inline uint32_t mean() const { return this->samples ? (uint32_t) (this->sum / this->samples) : 0; }
+    inline uint32_t budget() const { return this->limit; }
+    inline void budget(uint32_t budget) { this->limit = budget; }
+    // Values that exceeded the budget
+    inline uint32_t overruns() const { return this->over; }
+
+    // Value that pct percent of the recorded values do not exceed, rounded up to the end of its bucket
+    uint32_t percentile(byte pct) const {
+        uint32_t total = 0;
+        for (byte b = 0; b < Buckets; b++)
+            total += this->buckets[b];
+        if (total == 0)
+            return 0;
+        uint32_t rank = (total * pct + 99) / 100;
+        uint32_t seen = 0;
+        for (byte b = 0; b < Buckets; b++)
+        {
+            seen += this->buckets[b];
+            if (seen >= rank && seen != 0)
+            {
+                uint32_t upper = b + 1 < Buckets ? upperOf(b) : this->highest;
+                return upper < this->highest ? upper : this->highest;
+            }
+        }
+        return this->highest;
+    }
+
+    // Samples in bucket b, since the last halving
+    inline uint16_t bucket(byte b) const { return this->buckets[b]; }
+    static constexpr byte size() { return Buckets; }
+
+    // Lowest value bucket b counts
+    static uint32_t lowerOf(byte b) { return b == 0 ? 0 : uint32_t(1) << (b - 1); }
+    // Highest value bucket b counts, all values beyond for the last one
+    static uint32_t upperOf(byte b) { return b == 0 ? 0 : (b >= 32 ? ~uint32_t(0) : (uint32_t(1) << b) - 1); }
+
+    // Logs a summary line and a line per bucket holding samples
+    void dump(const __FlashStringHelper* name) const {
+        logs(name, F("n"), this->samples, F("min"), this->lowest, F("mean"), this->mean(),
+             F("p99"), this->percentile(99), F("max"), this->highest, F("over"), this->over);
+        for (byte b = 0; b < Buckets; b++)
+            if (this->buckets[b] != 0)
+                logs(F(" "), this->lowerOf(b), F("-"), b + 1 < Buckets ? this->upperOf(b) : this->highest,
+                     this->buckets[b]);
+    }
+private:
+    static byte bucketOf(uint32_t value) {
+        byte b = 0;
+        while (value != 0 && b + 1 < Buckets)
+        {
+            value >>= 1;
+            b++;
+        }
+        return b;
+    }
+
+    void halve() {
+        for (byte b = 0; b < Buckets; b++)
+            this->buckets[b] >>= 1;
+    }
+private:
+    uint16_t buckets[Buckets];
+    uint32_t samples;
+    uint64 sum;
+    uint32_t lowest, highest;
+    uint32_t limit;
+    uint32_t over;
+};
+
+END_NP_BLOCK
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef _STA_IDLE_
+#define _STA_IDLE_
+
+#include "sta.h"
+#include "clock.h"
+#include "coroutine.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#elif defined(ARDUINO_ARCH_HOST)
+#include <arduino_host.h>
+#endif
+
+/*
+Sleep of the loop between two iterations that have nothing to do.
+
+entry_point.h asks the app how long it may idle after every onUpdate(), through
+micro_controller::idleMicros(), takes the earliest timer of the timer wheel into
+account and calls sleep() for the time that is left. The app gathers what it
+knows, for instance the next wake-up of its coroutines:
+
+    unsigned long idleMicros() override {
+        if (Serial.available())
+            return 0;
+        return coroutines.idle_micros();
+    }
+
+An interrupt handler that signals a sta::event ends the sleep right away, so the
+coroutines blocked on it run without waiting for the deadline. Anything the app
+polls, like a pin or a serial port, is only looked at again once the sleep is
+over, so its idleMicros() must not report more than it can afford to miss.
+
+On AVR the CPU sleeps in SLEEP_MODE_IDLE. The timer behind millis() keeps running
+and wakes it every 1.024ms, the loop goes back to sleep until the time is up. On
+the host build the virtual clock skips ahead to the deadline, or stops at a
+raise_interrupt(). Other architectures do not sleep and keep polling.
+
+stats() counts the sleeps and the time spent in them. The wake-up latency is how
+late the loop iteration after a full sleep starts, compared to the deadline it
+slept until, measured by resumed() at the start of loop().
+*/
+
+// Shorter sleeps are not worth going to sleep for, in microseconds
+#ifndef STA_IDLE_MIN_US
+#define STA_IDLE_MIN_US 200
+#endif
+
+BEGIN_NP_BLOCK
+
+struct _STAXXEXPORT idle_stats {
+    // Times the loop went to sleep, and how many of them an interrupt ended early
+    unsigned long sleeps;
+    unsigned long interrupted;
+    uint64 idleMicros;
+    // Microseconds the iteration after the last full sleep started late, and the most it did
+    unsigned long lastLatency;
+    unsigned long maxLatency;
+};
+
+class _STAXXEXPORT loop_idle {
+public:
+    // Whether sleep() does sleep on this architecture
+#if defined(__AVR__) || defined(ARDUINO_ARCH_HOST)
+    static constexpr bool Supported = true;
+#else
+    static constexpr bool Supported = false;
+#endif
+
+    // Sleeps for at most us microseconds, or until an interrupt signals an event
+    static void sleep(unsigned long us) {
+        if (!Supported || us < STA_IDLE_MIN_US || event::pending())
+            return;
+        if (us > 0x7FFFFFFFUL)
+            us = 0x7FFFFFFFUL;
+
+        state& s = get();
+        uint32_t began = micros();
+        bool early = wait(began, (uint32_t) us);
+        s.stats.sleeps++;
+        s.stats.idleMicros += (uint32_t) micros() - began;
+        if (early)
+            s.stats.interrupted++;
+        s.wakeAt = began + (uint32_t) us;
+        s.waking = !early;
+    }
+
+    // Records the wake-up latency of the last sleep, called at the start of an iteration
+    static void resumed() {
+        state& s = get();
+        if (!s.waking)
+            return;
+        s.waking = false;
+        int32_t late = (int32_t) ((uint32_t) micros() - s.wakeAt);
+        s.stats.lastLatency = late > 0 ? (unsigned long) late : 0;
+        if (s.stats.lastLatency > s.stats.maxLatency)
+            s.stats.maxLatency = s.stats.lastLatency;
+    }
+
+    static const idle_stats& stats() { return get().stats; }
+
+    static void reset() {
+        get().stats = idle_stats();
+    }
+private:
+    struct state {
+        idle_stats stats;
+        // micros() at which the last sleep was due to end
+        uint32_t wakeAt;
+        bool waking;
+    };
+
+    static state& get() {
+        static state s = { idle_stats(), 0, false };
+        return s;
+    }
+
+    // Returns true when an interrupt ended the wait before the time was up
+    static bool wait(uint32_t began, uint32_t us) {
+#if defined(__AVR__)
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        while ((uint32_t) micros() - began < us)
+        {
+            cli();
+            if (event::pending())
+            {
+                sei();
+                return true;
+            }
+            sleep_enable();
+            // an interrupt pending now still wakes the CPU, sei takes effect after sleep_cpu
+            sei();
+            sleep_cpu();
+            sleep_disable();
+        }
+        return false;
+#elif defined(ARDUINO_ARCH_HOST)
+        (void) began;
+        uint64_t until = arduino_host::now_us() + us;
+        return arduino_host::idle_until_us(until) < until;
+#else
+        (void) began;
+        (void) us;
+        return false;
+#endif
+    }
+};
+
+END_NP_BLOCK
+
+#endif
@@ -5,6 +5,14 @@
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 
 #include "sta.h"
+
+// Placement new, the AVR cores ship it in new.h instead of <new>
+#if defined(__AVR__)
+#include <new.h>
+#else
+#include <new>
+#endif
+
 #include "utility.h"
 #include "iterator.h"
 #include "functional.h"
@@ -84,6 +92,280 @@ public:
 	template<class U> struct rebind { typedef allocator<U> other; };
 };
 
+// Strictest fundamental alignment, every pool block is aligned to it
+union _STAXXLOCAL max_align {
+	long long integer;
+	long double floating;
+	void* pointer;
+	void (*function)();
+};
+
+struct _STAXXEXPORT pool_stats {
+	size_t in_use;		// blocks handed out right now
+	size_t high_water;	// most blocks ever handed out at once
+	size_t failed;		// allocations that could not be served
+	size_t capacity;	// total number of blocks
+};
+
+/*
+Fixed-size block pool, allocate() and deallocate() are O(1) and never fragment.
+
+Count blocks of BlockSize bytes live inside the pool object itself (usually a
+global), free blocks are chained through their own first bytes. Blocks are handed
+out lazily, so constructing a pool costs nothing. Not interrupt safe.
+
+Basic usage:
+	static sta::block_pool<sizeof(message), 8> messages;
+
+	void* p = messages.allocate();
+	if (p == nullptr) ... // pool exhausted, messages.stats().failed was bumped
+	messages.deallocate(p);
+
+	// As the storage of pointers and containers
+	auto m = sta::allocate_unique<message>(messages, ...);
+*/
+template <size_t BlockSize, size_t Count>
+class _STAXXEXPORT block_pool {
+	static_assert(BlockSize > 0 && Count > 0, "block_pool needs at least one block of one byte");
+public:
+	block_pool() _STAXX_NOEXCEPT : freeList(nullptr), untouched(0), inUse(0), highWater(0), failedCount(0) {}
+	block_pool(const block_pool&) = delete;
+	block_pool& operator=(const block_pool&) = delete;
+public:
+	// One block, nullptr when the pool is exhausted or bytes does not fit a block
+	void* allocate(size_t bytes = BlockSize) _STAXX_NOEXCEPT {
+		void* p = nullptr;
+		if (bytes <= BlockSize) {
+			if (this->freeList) {
+				p = this->freeList;
+				this->freeList = this->freeList->next;
+			} else if (this->untouched < Count) {
+				p = this->storage + Stride * this->untouched++;
+			}
+		}
+		if (p == nullptr) {
+			this->failedCount++;
+			return nullptr;
+		}
+		if (++this->inUse > this->highWater) this->highWater = this->inUse;
+		return p;
+	}
+
+	void deallocate(void* p, size_t = 0) _STAXX_NOEXCEPT {
+		if (p == nullptr) return;
+		node* n = static_cast<node*>(p);
+		n->next = this->freeList;
+		this->freeList = n;
+		this->inUse--;
+	}
+
+	bool owns(const void* p) const _STAXX_NOEXCEPT {
+		const unsigned char* b = static_cast<const unsigned char*>(p);
+		return b >= this->storage && b < this->storage + sizeof(this->storage);
+	}
+public:
+	bool full() const _STAXX_NOEXCEPT { return this->inUse == Count; }
+	size_t available() const _STAXX_NOEXCEPT { return Count - this->inUse; }
+	pool_stats stats() const _STAXX_NOEXCEPT { return { this->inUse, this->highWater, this->failedCount, Count }; }
+
+	static constexpr size_t block_size() { return BlockSize; }
+	static constexpr size_t capacity() { return Count; }
+private:
+	struct node { node* next; };
+
+	static constexpr size_t Stride = ((BlockSize < sizeof(node) ? sizeof(node) : BlockSize) + alignof(max_align) - 1)
+		/ alignof(max_align) * alignof(max_align);
+private:
+	alignas(max_align) unsigned char storage[Stride * Count];
+	node* freeList;
+	size_t untouched;	// blocks past this index were never handed out
+	size_t inUse;
+	size_t highWater;
+	size_t failedCount;
+};
+
+/*
+Pool of 8, 16, 32 and 64 byte blocks for allocations of varying size.
+
+A request is served from the smallest class that fits and still has a free block,
+so a burst of small allocations spills into the bigger classes instead of failing.
+Requests above 64 bytes always fail. O(1) like block_pool.
+
+Basic usage:
+	static sta::size_class_pool<16, 8, 4, 2> pool; // blocks per class
+
+	sta::pool_allocator<int, decltype(pool)> alloc(pool);
+	sta::vector<int, decltype(alloc)> v(alloc, 4);
+*/
+template <size_t Count8, size_t Count16 = Count8, size_t Count32 = Count16, size_t Count64 = Count32>
+class _STAXXEXPORT size_class_pool {
+public:
+	size_class_pool() _STAXX_NOEXCEPT : inUse(0), highWater(0), failedCount(0) {}
+	size_class_pool(const size_class_pool&) = delete;
+	size_class_pool& operator=(const size_class_pool&) = delete;
+public:
+	void* allocate(size_t bytes) _STAXX_NOEXCEPT {
+		void* p = nullptr;
+		if (bytes <= 8 && !this->class8.full()) p = this->class8.allocate(bytes);
+		else if (bytes <= 16 && !this->class16.full()) p = this->class16.allocate(bytes);
+		else if (bytes <= 32 && !this->class32.full()) p = this->class32.allocate(bytes);
+		else if (bytes <= 64 && !this->class64.full()) p = this->class64.allocate(bytes);
+		if (p == nullptr) {
+			this->failedCount++;
+			return nullptr;
+		}
+		if (++this->inUse > this->highWater) this->highWater = this->inUse;
+		return p;
+	}
+
+	void deallocate(void* p, size_t = 0) _STAXX_NOEXCEPT {
+		if (p == nullptr) return;
+		if (this->class8.owns(p)) this->class8.deallocate(p);
+		else if (this->class16.owns(p)) this->class16.deallocate(p);
+		else if (this->class32.owns(p)) this->class32.deallocate(p);
+		else if (this->class64.owns(p)) this->class64.deallocate(p);
+		// not from this pool, chaining it into a free list would corrupt memory
+		else abort();
+		this->inUse--;
+	}
+
+	bool owns(const void* p) const _STAXX_NOEXCEPT {
+		return this->class8.owns(p) || this->class16.owns(p) || this->class32.owns(p) || this->class64.owns(p);
+	}
+public:
+	pool_stats stats() const _STAXX_NOEXCEPT { return { this->inUse, this->highWater, this->failedCount, capacity() }; }
+
+	// Statistics of a single class, blockSize is 8, 16, 32 or 64
+	pool_stats class_stats(size_t blockSize) const _STAXX_NOEXCEPT {
+		if (blockSize <= 8) return this->class8.stats();
+		if (blockSize <= 16) return this->class16.stats();
+		if (blockSize <= 32) return this->class32.stats();
+		return this->class64.stats();
+	}
+
+	static constexpr size_t capacity() { return Count8 + Count16 + Count32 + Count64; }
+private:
+	block_pool<8, Count8> class8;
+	block_pool<16, Count16> class16;
+	block_pool<32, Count32> class32;
+	block_pool<64, Count64> class64;
+	size_t inUse;
+	size_t highWater;
+	size_t failedCount;
+};
+
+/*
+Allocator that takes its memory from a block_pool or size_class_pool, for
+containers like sta::vector. It refers to the pool, which must outlive it.
+allocate() returns nullptr when the pool cannot serve the request.
+*/
+template <class T, class Pool>
+class _STAXXEXPORT pool_allocator {
+public:
+	typedef T value_type;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	typedef T* pointer;
+	typedef const T* const_pointer;
+
+	typedef T& reference;
+	typedef const T& const_reference;
+
+	template <class U> struct rebind { typedef pool_allocator<U, Pool> other; };
+public:
+	pool_allocator(Pool& pool) _STAXX_NOEXCEPT : _pool(&pool) {}
+	template <class U> pool_allocator(const pool_allocator<U, Pool>& other) _STAXX_NOEXCEPT : _pool(&other.pool()) {}
+public:
+	pointer allocate(size_type n) { return static_cast<T*>(this->_pool->allocate(n * sizeof(T))); }
+	void deallocate(pointer p, size_type n) { this->_pool->deallocate(p, n * sizeof(T)); }
+
+	Pool& pool() const _STAXX_NOEXCEPT { return *this->_pool; }
+public:
+	template <class U>
+	bool operator==(const pool_allocator<U, Pool>& other) const { return this->_pool == &other.pool(); }
+	template <class U>
+	bool operator!=(const pool_allocator<U, Pool>& other) const { return this->_pool != &other.pool(); }
+private:
+	Pool* _pool;
+};
+
+/*
+Linear (bump) allocator over a fixed buffer, for objects that live until power-off.
+
+Allocations are packed back to back with no header, only padded to alignment.
+deallocate() can only take back the most recent allocation, anything else stays
+used until reset(). Has the allocate/deallocate shape of the pools, so it works
+with pool_allocator and allocate_unique too.
+
+Basic usage:
+	static sta::static_arena<256> boot;
+
+	auto filter = sta::allocate_unique<moving_average>(boot, 8);
+	sta::log("boot arena: ", boot.used(), " bytes");
+*/
+class _STAXXEXPORT arena {
+public:
+	arena(void* buffer, size_t size) _STAXX_NOEXCEPT
+		: begin(static_cast<unsigned char*>(buffer)), top(0), size(size), last(nullptr), highWater(0), failedCount(0) {}
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+public:
+	// bytes from the arena, nullptr when it is full
+	void* allocate(size_t bytes, size_t align = alignof(max_align)) _STAXX_NOEXCEPT {
+		size_t start = (this->top + align - 1) & ~(align - 1);
+		if (start > this->size || bytes > this->size - start) {
+			this->failedCount++;
+			return nullptr;
+		}
+		this->last = this->begin + start;
+		this->top = start + bytes;
+		if (this->top > this->highWater) this->highWater = this->top;
+		return this->last;
+	}
+
+	// Only the most recent allocation is given back, for example a vector growing in place
+	void deallocate(void* p, size_t = 0) _STAXX_NOEXCEPT {
+		if (p != nullptr && p == this->last) {
+			this->top = this->last - this->begin;
+			this->last = nullptr;
+		}
+	}
+
+	// Forgets every allocation, the objects in the arena must not be used anymore
+	void reset() _STAXX_NOEXCEPT {
+		this->top = 0;
+		this->last = nullptr;
+	}
+
+	bool owns(const void* p) const _STAXX_NOEXCEPT {
+		const unsigned char* b = static_cast<const unsigned char*>(p);
+		return b >= this->begin && b < this->begin + this->size;
+	}
+public:
+	size_t used() const _STAXX_NOEXCEPT { return this->top; }
+	size_t remaining() const _STAXX_NOEXCEPT { return this->size - this->top; }
+	size_t capacity() const _STAXX_NOEXCEPT { return this->size; }
+	size_t high_water() const _STAXX_NOEXCEPT { return this->highWater; }
+	size_t failed() const _STAXX_NOEXCEPT { return this->failedCount; }
+private:
+	unsigned char* begin;
+	size_t top;
+	size_t size;
+	unsigned char* last;
+	size_t highWater;
+	size_t failedCount;
+};
+
+// Arena with its buffer inside the object
+template <size_t Size>
+class _STAXXEXPORT static_arena : public arena {
+public:
+	static_arena() _STAXX_NOEXCEPT : arena(buffer, Size) {}
+private:
+	alignas(max_align) unsigned char buffer[Size];
+};
+
 template <class Out, class T> 
 class _STAXXEXPORT raw_storage_iterator
 	: public iterator<output_iterator_tag, void, void, void, void>
@@ -233,8 +515,8 @@ public:
 };
 
 template <class T, typename... Args>
-auto_ptr<T> make_auto(Args... args) {
-	return auto_ptr<T>(new T(args...));
+auto_ptr<T> make_auto(Args&&... args) {
+	return auto_ptr<T>(new T(sta::forward<Args>(args)...));
 }
 
 /*
@@ -249,24 +531,52 @@ and thus no other managed pointer should point to its managed object, since as s
 unique_ptr objects delete their managed object without taking into account whether other pointers still point to the same object or not,
 and thus leaving any other pointers that point there as pointing to an invalid location.
 */
-template<typename T> 
-class _STAXXEXPORT unique_ptr {
+// Default deleter of unique_ptr, frees with delete
+template <class T>
+struct _STAXXEXPORT default_delete {
+	default_delete() _STAXX_NOEXCEPT {}
+	template <class U> default_delete(const default_delete<U>&) _STAXX_NOEXCEPT {}
+
+	void operator()(T* p) const { delete p; }
+};
+
+// Deleter of unique_ptr for objects living in a block_pool or size_class_pool
+template <class T, class Pool>
+class _STAXXEXPORT pool_delete {
+public:
+	pool_delete(Pool& pool) _STAXX_NOEXCEPT : _pool(&pool) {}
+	template <class U> pool_delete(const pool_delete<U, Pool>& other) _STAXX_NOEXCEPT : _pool(&other.pool()) {}
+
+	void operator()(T* p) const {
+		if (p == nullptr) return;
+		p->~T();
+		this->_pool->deallocate(p, sizeof(T));
+	}
+
+	Pool& pool() const _STAXX_NOEXCEPT { return *this->_pool; }
+private:
+	Pool* _pool;
+};
+
+template<typename T, class Deleter = default_delete<T>> 
+class _STAXXEXPORT unique_ptr : private Deleter {
 public: // CON-/DESTRUCTORS
 	unique_ptr() _STAXX_USE_NOEXCEPT : unique_ptr(nullptr) {}
-	unique_ptr(T* t) _STAXX_USE_NOEXCEPT : _ptr(t) {}
+	unique_ptr(T* t) _STAXX_USE_NOEXCEPT : Deleter(), _ptr(t) {}
+	unique_ptr(T* t, const Deleter& deleter) _STAXX_USE_NOEXCEPT : Deleter(deleter), _ptr(t) {}
 
-	template <class OtherType>
-	unique_ptr(unique_ptr<OtherType>& other) _STAXX_USE_NOEXCEPT : _ptr(other._unsafe_get()) {
-		other._unsafe_set(nullptr);
-	}
+	unique_ptr(unique_ptr&& other) _STAXX_USE_NOEXCEPT : Deleter(other.get_deleter()), _ptr(other.release()) {}
 
-	template <class OtherType>
-	unique_ptr(unique_ptr<OtherType>&& other) _STAXX_USE_NOEXCEPT : _ptr(other._unsafe_get()) {
-		other._unsafe_set(nullptr);
-	}
+	template <class OtherType, class OtherDeleter>
+	unique_ptr(unique_ptr<OtherType, OtherDeleter>& other) _STAXX_USE_NOEXCEPT 
+		: Deleter(other.get_deleter()), _ptr(other.release()) {}
+
+	template <class OtherType, class OtherDeleter>
+	unique_ptr(unique_ptr<OtherType, OtherDeleter>&& other) _STAXX_USE_NOEXCEPT 
+		: Deleter(other.get_deleter()), _ptr(other.release()) {}
 
 	~unique_ptr() {
-		delete _ptr;
+		if (_ptr) this->get_deleter()(_ptr);
 	}
 public:
 
@@ -286,28 +596,34 @@ public:
 
 	void reset(T* p = 0) _STAXX_USE_NOEXCEPT {
 		if (p != _ptr) {
-			delete _ptr;
+			if (_ptr) this->get_deleter()(_ptr);
 			_ptr = p;
 		}
 	}
 
+	Deleter& get_deleter() _STAXX_USE_NOEXCEPT { return *this; }
+	const Deleter& get_deleter() const _STAXX_USE_NOEXCEPT { return *this; }
 private:
 	T* _ptr;
 public: // OPERATORS
-	unique_ptr<T>* operator=(T* t) {
-		if (_ptr) delete _ptr;
-		_ptr = t;
+	unique_ptr* operator=(T* t) {
+		this->reset(t);
 		return this;
 	}
 
-	template <class OtherType>
-	unique_ptr<T>* operator=(unique_ptr<OtherType>& other) {
-		if (_ptr) delete _ptr;
-		_ptr = other._unsafe_get();
-		other._unsafe_set(nullptr);
+	template <class OtherType, class OtherDeleter>
+	unique_ptr* operator=(unique_ptr<OtherType, OtherDeleter>& other) {
+		if (static_cast<void*>(&other) == this) return this;
+		this->reset(other.release());
+		this->get_deleter() = other.get_deleter();
 		return this;
 	}
 
+	template <class OtherType, class OtherDeleter>
+	unique_ptr* operator=(unique_ptr<OtherType, OtherDeleter>&& other) {
+		return this->operator=(other);
+	}
+
 	T& operator*() const _STAXX_USE_NOEXCEPT {
 		return *this->_ptr;
 	}
@@ -323,8 +639,15 @@ public: // OPERATORS
 };
 
 template <class T, typename... Args>
-unique_ptr<T> make_unique(Args... args) {
-	return unique_ptr<T>(new T(args...));
+unique_ptr<T> make_unique(Args&&... args) {
+	return unique_ptr<T>(new T(sta::forward<Args>(args)...));
+}
+
+// Like make_unique, but the object lives in the given pool. Empty when the pool is exhausted
+template <class T, class Pool, typename... Args>
+unique_ptr<T, pool_delete<T, Pool>> allocate_unique(Pool& pool, Args&&... args) {
+	void* p = pool.allocate(sizeof(T));
+	return unique_ptr<T, pool_delete<T, Pool>>(p ? new(p) T(sta::forward<Args>(args)...) : nullptr, pool_delete<T, Pool>(pool));
 }
 
 // Non owning reference
@@ -377,8 +700,23 @@ private: // ATTRIBUTES
 };
 
 template <class T, typename... Args>
-ref_ptr<T> make_ref(Args... args) {
-	return ref_ptr<T>(new T(args...));
+ref_ptr<T> make_ref(Args&&... args) {
+	return ref_ptr<T>(new T(sta::forward<Args>(args)...));
+}
+
+// Like make_ref, but the object lives in the given pool. Null when the pool is exhausted
+template <class T, class Pool, typename... Args>
+ref_ptr<T> allocate_ref(Pool& pool, Args&&... args) {
+	void* p = pool.allocate(sizeof(T));
+	return ref_ptr<T>(p ? new(p) T(sta::forward<Args>(args)...) : nullptr);
+}
+
+// Destroys an object created with allocate_ref and gives its block back to the pool
+template <class T, class Pool>
+void deallocate_ref(Pool& pool, ref_ptr<T>& ref) {
+	pool_delete<T, Pool> deleter(pool);
+	deleter(ref._unsafe_get());
+	ref._unsafe_set(nullptr);
 }
 
 template <class T>
@@ -0,0 +1,127 @@
+#ifndef _STA_PROFILE_
+#define _STA_PROFILE_
+
+#include "sta.h"
+#include "../log.h"
+
+/*
+Zone profiler, attributes time to regions of code.
+
+STA_PROFILE_ZONE("name") at the top of a block measures the block, from that line
+to the end of its scope, with micros(). Every zone counts its calls, the total and
+the longest time spent in it. The zones live in static storage next to the code
+they measure and link themselves into one list the first time they are left, so
+nothing is allocated and a call costs two reads of micros() and a few additions.
+
+Basic usage:
+    #define STA_PROFILE_ZONES // before including sta++
+
+    void send() {
+        STA_PROFILE_ZONE("send");
+        ...
+    }
+    ...
+    sta::profile_zone::dump(); // zone calls total_us max_us avg_us, one line per zone
+
+To stream the numbers elsewhere, walk the list from profile_zone::first() on.
+
+Without STA_PROFILE_ZONES the macro expands to nothing. The framework puts zones
+in nextion_serial::setComponentText(), keypad::scanKeys() and
+pid_controller::Compute(). Zone names stay in flash on AVR. micros() counts in
+steps of 4us on a 16MHz AVR, so zones much shorter than that only show up in
+their totals.
+*/
+
+BEGIN_NP_BLOCK
+
+class _STAXXEXPORT profile_zone {
+public: // CON-/DESTRUCTORS
+    // name points to flash on AVR
+    constexpr profile_zone(const char* name) _STAXX_NOEXCEPT
+        : name(name), calls(0), totalMicros(0), maxMicros(0), nextZone(NULL), linked(false)
+    {}
+
+    profile_zone(const profile_zone&) = delete;
+    profile_zone& operator=(const profile_zone&) = delete;
+public:
+    void record(unsigned long micros) {
+        if (!this->linked)
+        {
+            this->nextZone = head();
+            head() = this;
+            this->linked = true;
+        }
+        this->calls++;
+        this->totalMicros += micros;
+        if (micros > this->maxMicros)
+            this->maxMicros = micros;
+    }
+
+    inline const __FlashStringHelper* label() const { return reinterpret_cast<const __FlashStringHelper*>(this->name); }
+    inline unsigned long count() const { return this->calls; }
+    inline unsigned long total() const { return this->totalMicros; }
+    inline unsigned long longest() const { return this->maxMicros; }
+    inline const profile_zone* next() const { return this->nextZone; }
+
+    // The zones entered so far, the most recently added first
+    static const profile_zone* first() { return head(); }
+
+    // Prints every zone, one line each
+    static void dump() {
+        logs(F("zone"), F("calls"), F("total_us"), F("max_us"), F("avg_us"));
+        for (const profile_zone* zone = head(); zone; zone = zone->nextZone)
+            logs(zone->label(), zone->calls, zone->totalMicros, zone->maxMicros,
+                 zone->calls ? zone->totalMicros / zone->calls : 0UL);
+    }
+
+    // Clears the numbers of every zone
+    static void reset() {
+        for (profile_zone* zone = head(); zone; zone = zone->nextZone)
+        {
+            zone->calls = 0;
+            zone->totalMicros = 0;
+            zone->maxMicros = 0;
+        }
+    }
+private:
+    static profile_zone*& head() {
+        static profile_zone* zones = NULL;
+        return zones;
+    }
+private:
+    const char* name;
+    unsigned long calls;
+    unsigned long totalMicros, maxMicros;
+    profile_zone* nextZone;
+    bool linked;
+};
+
+// Measures its own lifetime into a zone, see STA_PROFILE_ZONE
+class _STAXXLOCAL profile_scope {
+public: // CON-/DESTRUCTORS
+    explicit profile_scope(profile_zone& zone) _STAXX_NOEXCEPT : zone(zone), began(micros()) {}
+    ~profile_scope() { this->zone.record(micros() - this->began); }
+
+    profile_scope(const profile_scope&) = delete;
+    profile_scope& operator=(const profile_scope&) = delete;
+private:
+    profile_zone& zone;
+    unsigned long began;
+};
+
+END_NP_BLOCK
+
+#define STA_PROFILE_JOIN_(a, b) a##b
+#define STA_PROFILE_JOIN(a, b) STA_PROFILE_JOIN_(a, b)
+
+#ifdef STA_PROFILE_ZONES
+// Profiles the rest of the enclosing scope as the zone name, a string literal
+#define STA_PROFILE_ZONE(name)                                                                          \
+    static const char STA_PROFILE_JOIN(staZoneName, __LINE__)[] PROGMEM = name;                         \
+    static sta::profile_zone STA_PROFILE_JOIN(staZone, __LINE__)(STA_PROFILE_JOIN(staZoneName, __LINE__)); \
+    sta::profile_scope STA_PROFILE_JOIN(staZoneScope, __LINE__)(STA_PROFILE_JOIN(staZone, __LINE__))
+#else
+#define STA_PROFILE_ZONE(name) ((void) 0)
+#endif
+
+#endif
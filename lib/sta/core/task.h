@@ -0,0 +1,304 @@
+#ifndef _STA_TASK_
+#define _STA_TASK_
+
+#include "sta.h"
+
+/*
+C++20 backend for sta::coroutines<N>, built on the language's stackless coroutines.
+
+A task is an ordinary function returning sta::task<T>: it takes parameters, keeps
+its locals as normal variables in its frame, may yield anywhere (even twice on one
+line) and returns a value with co_return. It is started in the same coroutines<N>
+manager as the classic BEGIN_COROUTINE functions, so both kinds can run side by side
+while code migrates:
+
+    sta::task<> blink(byte pin, unsigned long period) {
+        for (;;) {
+            digitalWrite(pin, HIGH);
+            co_await sta::sleep_for(period);
+            digitalWrite(pin, LOW);
+            co_await sta::sleep_for(period);
+        }
+    }
+
+    sta::task<int> average(byte pin) {
+        long sum = 0;
+        for (int i = 0; i < 8; i++) {
+            sum += analogRead(pin);
+            co_await sta::sleep_for(10);
+        }
+        co_return sum / 8;
+    }
+
+    sta::task<> report() {
+        int value = co_await average(A0); // runs the task and suspends until it returns
+        Serial.println(value);
+    }
+
+    coroutines.start(blink(LED_BUILTIN, 500));
+    coroutines.start(report());
+
+sleep_for(0) yields until the next update(), sleep_for_us() takes microseconds.
+co_await sta::wait_event(ev[, timeout]) blocks on a sta::event and returns false
+when the timeout ran out. The coroutine context object returned by start() works
+for tasks too: suspend(), resume() and terminate() behave as for classic
+coroutines, terminating destroys the frames and so runs the destructors of the
+task's locals.
+
+Frames never touch the heap, they come from a pool of STA_TASK_FRAME_COUNT blocks
+of STA_TASK_FRAME_SIZE bytes. Every task that is alive, including the ones being
+awaited, holds one block. When a frame does not fit or the pool is exhausted the
+task is empty (operator bool returns false): starting it ends it right away and
+awaiting it aborts.
+
+Needs a compiler with C++20 coroutine support (-std=gnu++20 or later), otherwise
+this header declares nothing. The AVR toolchain has none, so this is for the
+larger ARM boards and the host build.
+*/
+
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define STA_HAS_TASKS 1
+#endif
+#endif
+
+#ifdef STA_HAS_TASKS
+
+#include <coroutine>
+
+#include "coroutine.h"
+#include "memory.h"
+
+// Bytes per task frame, the compiler decides how big a frame is
+#ifndef STA_TASK_FRAME_SIZE
+#define STA_TASK_FRAME_SIZE 128
+#endif
+
+// Frames that can be alive at once
+#ifndef STA_TASK_FRAME_COUNT
+#define STA_TASK_FRAME_COUNT 8
+#endif
+
+BEGIN_NP_BLOCK
+
+typedef block_pool<STA_TASK_FRAME_SIZE, STA_TASK_FRAME_COUNT> task_frame_pool;
+
+// Pool all task frames are allocated from, its stats() show how many are in use
+inline task_frame_pool task_frames;
+
+// Promise state shared by all tasks, whatever they return
+struct _STAXXLOCAL task_promise_base {
+    // This task's frame
+    std::coroutine_handle<> self;
+    // The task awaiting this one, NULL for the task started in the manager
+    task_promise_base* parent = nullptr;
+    // Manager slot running the chain of tasks
+    coroutine_impl* context = nullptr;
+
+    static void* operator new(size_t size) noexcept { return task_frames.allocate(size); }
+    static void operator delete(void* frame) noexcept { task_frames.deallocate(frame); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { abort(); }
+
+    // Resumes the awaiting task, a finished root task frees its own frame
+    struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept {
+            task_promise_base& promise = *this->promise;
+            if (promise.parent)
+                return promise.parent->self;
+            if (promise.context)
+                promise.context->frame = nullptr;
+            h.destroy();
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+
+        task_promise_base* promise;
+    };
+
+    final_awaiter final_suspend() noexcept { return { this }; }
+};
+
+template <class T>
+struct _STAXXLOCAL task_promise : task_promise_base {
+    alignas(T) unsigned char result[sizeof(T)];
+    bool hasResult = false;
+
+    ~task_promise() {
+        if (this->hasResult) reinterpret_cast<T*>(this->result)->~T();
+    }
+
+    template <class U>
+    void return_value(U&& value) {
+        ::new (static_cast<void*>(this->result)) T(sta::forward<U>(value));
+        this->hasResult = true;
+    }
+
+    T take() { return sta::move(*reinterpret_cast<T*>(this->result)); }
+};
+
+template <>
+struct _STAXXLOCAL task_promise<void> : task_promise_base {
+    void return_void() noexcept {}
+    void take() noexcept {}
+};
+
+/*
+Lazily started C++20 coroutine, see the top of this file.
+A task owns its frame until it is started in a coroutines<N> manager or awaited.
+*/
+template <class T = void>
+class _STAXXEXPORT task {
+public:
+    struct promise_type : task_promise<T> {
+        task get_return_object() noexcept {
+            this->self = std::coroutine_handle<promise_type>::from_promise(*this);
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        static task get_return_object_on_allocation_failure() noexcept { return task(); }
+    };
+public: // CON-/DESTRUCTORS
+    task() noexcept : handle(nullptr) {}
+    task(task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() {
+        if (this->handle) this->handle.destroy();
+    }
+private: // INTERNAL TYPES
+    struct awaiter {
+        std::coroutine_handle<promise_type> child;
+
+        bool await_ready() noexcept { return false; }
+
+        template <class Parent>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Parent> parent) noexcept {
+            // the awaited task could not get a frame
+            if (!this->child) abort();
+            this->child.promise().parent = &parent.promise();
+            this->child.promise().context = parent.promise().context;
+            return this->child;
+        }
+
+        T await_resume() { return this->child.promise().take(); }
+    };
+public: // OPERATORS
+    // Destroys the frame this task owns and takes over the other one's
+    task& operator=(task&& other) noexcept {
+        if (this == &other) return *this;
+        if (this->handle) this->handle.destroy();
+        this->handle = other.handle;
+        other.handle = nullptr;
+        return *this;
+    }
+
+    explicit operator bool() const noexcept { return static_cast<bool>(this->handle); }
+
+    // Runs the task as part of the awaiting one and returns its result
+    awaiter operator co_await() && noexcept { return awaiter { this->handle }; }
+public: // MANAGER INTERFACE
+    // Body of the manager slot: resumes the innermost suspended task of the chain
+    static void trampoline(coroutine_interface& coroutine) {
+        coroutine_impl& slot = (coroutine_impl&) coroutine;
+        task_promise_base* current = static_cast<task_promise_base*>(slot.frame);
+        if (current && slot.jumpLocation == -1)
+        {
+            // terminated from the outside, destroying the root frees the whole chain
+            while (current->parent)
+                current = current->parent;
+            current->self.destroy();
+            slot.frame = nullptr;
+        }
+        else if (current)
+            current->self.resume();
+        slot.terminated = slot.frame == nullptr;
+    }
+
+    // Hands the frame over to a manager slot, the task is empty afterwards
+    void* release(coroutine_impl& slot) noexcept {
+        if (!this->handle) return nullptr;
+        this->handle.promise().context = &slot;
+        void* frame = static_cast<task_promise_base*>(&this->handle.promise());
+        this->handle = nullptr;
+        return frame;
+    }
+private:
+    explicit task(std::coroutine_handle<promise_type> h) noexcept : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Awaiter suspending the running task for the given milliseconds, 0 yields until the next update
+struct _STAXXEXPORT sleep_for {
+    explicit sleep_for(unsigned long ms) noexcept : ms(ms) {}
+
+    bool await_ready() noexcept { return false; }
+
+    template <class Promise>
+    void await_suspend(std::coroutine_handle<Promise> h) noexcept {
+        task_promise_base& promise = h.promise();
+        promise.context->frame = &promise;
+        promise.context->wait(this->ms);
+    }
+
+    void await_resume() noexcept {}
+
+    unsigned long ms;
+};
+
+// Awaiter suspending the running task for the given microseconds, see STA_COROUTINE_TICK_US
+struct _STAXXEXPORT sleep_for_us {
+    explicit sleep_for_us(unsigned long us) noexcept : us(us) {}
+
+    bool await_ready() noexcept { return false; }
+
+    template <class Promise>
+    void await_suspend(std::coroutine_handle<Promise> h) noexcept {
+        task_promise_base& promise = h.promise();
+        promise.context->frame = &promise;
+        promise.context->wait_us(this->us);
+    }
+
+    void await_resume() noexcept {}
+
+    unsigned long us;
+};
+
+// Awaiter suspending the running task until the event is signalled, optionally giving up
+// after the given milliseconds. Returns true when signalled, false on timeout.
+struct _STAXXEXPORT wait_event {
+    explicit wait_event(event& ev) noexcept : ev(ev), timeout(0), forever(true) {}
+    wait_event(event& ev, unsigned long timeout) noexcept : ev(ev), timeout(timeout), forever(false) {}
+
+    bool await_ready() noexcept { return false; }
+
+    template <class Promise>
+    void await_suspend(std::coroutine_handle<Promise> h) noexcept {
+        task_promise_base& promise = h.promise();
+        promise.context->frame = &promise;
+        this->context = promise.context;
+        if (this->forever)
+            this->context->wait_event(this->ev);
+        else
+            this->context->wait_event(this->ev, this->timeout);
+    }
+
+    bool await_resume() noexcept { return !this->context->isTimedOut(); }
+
+    event& ev;
+    unsigned long timeout;
+    bool forever;
+    coroutine_impl* context = nullptr;
+};
+
+END_NP_BLOCK
+
+#endif // STA_HAS_TASKS
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef _STA_TIMER_WHEEL_
+#define _STA_TIMER_WHEEL_
+
+#include "sta.h"
+#include "containers.h"
+
+/*
+Hierarchical timing wheel, the shared service behind sta::timer.
+
+Deadlines are kept in STA_TIMER_WHEEL_LEVELS wheels of 2^STA_TIMER_WHEEL_BITS
+buckets. The first wheel has a bucket per tick, every next one a bucket per turn
+of the wheel below it, and a deadline sits in the lowest wheel its distance fits
+in. When a wheel completes a turn, the bucket coming up on the wheel above is
+moved down. Scheduling and cancelling are O(1). update() visits only the buckets
+that hold entries, since every wheel keeps a bitset of its occupied buckets and
+the empty stretches in between are skipped.
+
+Deadlines are compared through their 32-bit difference, so they survive the
+wrap-around of millis(). A deadline may not be further away than 2^31 ticks.
+Past the range of the top wheel (2^(BITS * LEVELS) ticks, about 65 seconds at the
+default 1ms per tick), an entry waits in the top wheel and is re-filed each
+turn.
+
+Basic usage:
+    void blink(void* context) {
+        digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+    }
+
+    sta::timer_entry entry(&blink);
+    sta::timers().schedule(entry, millis() + 500);
+
+    void loop() {
+        sta::timers().update(millis()); // done by entry_point.h when using the framework
+    }
+
+An entry must stay alive while it is scheduled, destroying it cancels it. Its
+callback runs from update() and may schedule or cancel any entry, itself included.
+A deadline that has already passed, like millis() from a callback, fires on the
+next update(), even one given the same time.
+*/
+
+// Bits of a wheel's index, each wheel has 2^bits buckets
+#ifndef STA_TIMER_WHEEL_BITS
+#define STA_TIMER_WHEEL_BITS 4
+#endif
+
+// Number of wheels
+#ifndef STA_TIMER_WHEEL_LEVELS
+#define STA_TIMER_WHEEL_LEVELS 4
+#endif
+
+BEGIN_NP_BLOCK
+
+class timer_wheel;
+
+// A deadline in a timer_wheel, meant to be a member of the object it calls back
+class _STAXXEXPORT timer_entry {
+public:
+    typedef void (*callback)(void* context);
+public: // CON-/DESTRUCTORS
+    timer_entry(callback expire = NULL, void* context = NULL) _STAXX_NOEXCEPT
+        : next(NULL), prev(NULL), wheel(NULL), expires(0), expire(expire), context(context), level(0), slot(0)
+    {}
+    // Copies are neither scheduled nor bound, the owner binds them again
+    timer_entry(const timer_entry&) _STAXX_NOEXCEPT : timer_entry() {}
+    timer_entry& operator=(const timer_entry&) _STAXX_NOEXCEPT { return *this; }
+
+    ~timer_entry() { this->cancel(); }
+public:
+    // Sets what update() calls once the deadline passed
+    void bind(callback expire, void* context) _STAXX_NOEXCEPT {
+        this->expire = expire;
+        this->context = context;
+    }
+
+    inline void cancel();
+
+    inline bool isScheduled() const { return this->wheel != NULL; }
+    inline uint32_t deadline() const { return this->expires; }
+private:
+    friend class timer_wheel;
+
+    timer_entry* next;
+    timer_entry** prev;
+    timer_wheel* wheel;
+    uint32_t expires;
+    callback expire;
+    void* context;
+    // The bucket the entry was filed in, level is Levels for the overdue ones
+    byte level, slot;
+};
+
+class _STAXXEXPORT timer_wheel {
+public:
+    static constexpr byte Bits = STA_TIMER_WHEEL_BITS;
+    static constexpr byte Levels = STA_TIMER_WHEEL_LEVELS;
+    static constexpr size_t Slots = size_t(1) << Bits;
+    static constexpr uint32_t Mask = Slots - 1;
+
+    static_assert(Bits > 0 && Bits <= 8 && Levels > 0 && Bits * Levels <= 31,
+                  "the wheels must span at most 2^31 ticks");
+public: // CON-/DESTRUCTORS
+    timer_wheel(uint32_t now = 0) _STAXX_NOEXCEPT : overdue(NULL), current(now), time(now), count(0), updating(false) {
+        for (byte l = 0; l < Levels; l++)
+            for (size_t i = 0; i < Slots; i++)
+                this->buckets[l][i] = NULL;
+    }
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+public:
+    // Calls the entry's callback once deadline passed, rescheduling it if it already is
+    void schedule(timer_entry& entry, uint32_t deadline) {
+        this->cancel(entry);
+        entry.expires = deadline;
+        this->insert(entry);
+    }
+
+    void cancel(timer_entry& entry) {
+        if (entry.wheel != this)
+            return;
+        *entry.prev = entry.next;
+        if (entry.next)
+            entry.next->prev = entry.prev;
+        if (entry.level < Levels && this->buckets[entry.level][entry.slot] == NULL)
+            this->occupied[entry.level].reset(entry.slot);
+        entry.next = NULL;
+        entry.prev = NULL;
+        entry.wheel = NULL;
+        this->count--;
+    }
+
+    // Runs the callbacks of every entry whose deadline is at or before now
+    void update(uint32_t now) {
+        // a callback updating the wheel again has nothing to add
+        if (this->updating)
+            return;
+        this->updating = true;
+        this->time = now;
+
+        // deadlines that had passed when they were scheduled, the ones scheduled meanwhile wait for the next update
+        timer_entry* pending = this->overdue;
+        this->overdue = NULL;
+        if (pending)
+            pending->prev = &pending;
+        this->fire(pending);
+
+        while (this->count != 0 && due(this->current, now))
+        {
+            uint32_t distance = this->distance();
+            if (distance > now - this->current)
+                break;
+            this->current += distance;
+            this->tick();
+        }
+        if (due(this->current, now))
+            this->current = now + 1;
+
+        this->updating = false;
+    }
+
+    // Earliest tick at which update() has work to do, returns false when nothing is scheduled.
+    // Exact for the entries in the first wheel, the others may set it earlier, to the tick
+    // that moves them down a wheel. Overdue entries make it the time of the last update.
+    bool next_expiry(uint32_t& deadline) const {
+        if (this->count == 0)
+            return false;
+        deadline = this->overdue ? this->current - 1 : this->current + this->distance();
+        return true;
+    }
+
+    // Time given to the last update()
+    inline uint32_t now() const { return this->time; }
+    // Number of scheduled entries
+    inline size_t size() const { return this->count; }
+    inline bool empty() const { return this->count == 0; }
+private:
+    static bool due(uint32_t time, uint32_t now) {
+        return (int32_t) (now - time) >= 0;
+    }
+
+    // Files an entry in the lowest wheel its distance fits in
+    void insert(timer_entry& entry) {
+        uint32_t delta = entry.expires - this->current;
+        uint32_t expires = entry.expires;
+        if ((int32_t) delta < 0)
+        {
+            // before the next tick, runs on the next update whatever its time
+            this->link(this->overdue, entry, Levels, 0);
+            return;
+        }
+        if (delta >> (Bits * Levels))
+        {
+            // beyond the top wheel, waits in its furthest bucket
+            delta = (uint32_t(1) << (Bits * Levels)) - 1;
+            expires = this->current + delta;
+        }
+
+        byte level = 0;
+        while (level + 1 < Levels && delta >> (Bits * (level + 1)))
+            level++;
+        byte slot = (expires >> (Bits * level)) & Mask;
+
+        this->link(this->buckets[level][slot], entry, level, slot);
+        this->occupied[level].set(slot);
+    }
+
+    void link(timer_entry*& head, timer_entry& entry, byte level, byte slot) {
+        entry.next = head;
+        if (head)
+            head->prev = &entry.next;
+        entry.prev = &head;
+        head = &entry;
+        entry.level = level;
+        entry.slot = slot;
+        entry.wheel = this;
+        this->count++;
+    }
+
+    // Runs the callbacks of a detached list of entries
+    void fire(timer_entry*& pending) {
+        while (pending)
+        {
+            timer_entry& entry = *pending;
+            this->cancel(entry);
+            if (entry.expire)
+                entry.expire(entry.context);
+        }
+    }
+
+    // Ticks from current to the next one that fires a bucket or moves one down
+    uint32_t distance() const {
+        uint32_t best = ~uint32_t(0);
+        for (byte l = 0; l < Levels; l++)
+        {
+            if (!this->occupied[l].any())
+                continue;
+            byte shift = Bits * l;
+            // first tick at or after current where this wheel's bucket is processed
+            uint32_t turn = (this->current >> shift) + ((this->current & ((uint32_t(1) << shift) - 1)) != 0);
+            size_t start = turn & Mask;
+            size_t slot = this->occupied[l].test(start) ? start : this->occupied[l].find_next(start);
+            if (slot >= Slots)
+                slot = this->occupied[l].find_first();
+            uint32_t at = (turn + ((slot - start) & Mask)) << shift;
+            if (at - this->current < best)
+                best = at - this->current;
+        }
+        return best;
+    }
+
+    // Processes the tick current: moves the buckets of finished turns down, then fires
+    void tick() {
+        uint32_t t = this->current;
+        for (byte l = 1; l < Levels && (t & ((uint32_t(1) << (Bits * l)) - 1)) == 0; l++)
+            this->cascade(l, (t >> (Bits * l)) & Mask);
+
+        // detach the due bucket, callbacks may file new entries in it
+        size_t slot = t & Mask;
+        timer_entry* pending = this->buckets[0][slot];
+        this->buckets[0][slot] = NULL;
+        this->occupied[0].reset(slot);
+        if (pending)
+            pending->prev = &pending;
+        this->current = t + 1;
+        this->fire(pending);
+    }
+
+    void cascade(byte level, size_t slot) {
+        timer_entry* entry = this->buckets[level][slot];
+        this->buckets[level][slot] = NULL;
+        this->occupied[level].reset(slot);
+        while (entry)
+        {
+            timer_entry* next = entry->next;
+            this->count--;
+            this->insert(*entry);
+            entry = next;
+        }
+    }
+private:
+    timer_entry* buckets[Levels][Slots];
+    bitset<Slots> occupied[Levels];
+    // Entries whose deadline had passed when they were scheduled
+    timer_entry* overdue;
+    // The next tick to process
+    uint32_t current;
+    uint32_t time;
+    size_t count;
+    bool updating;
+};
+
+inline void timer_entry::cancel() {
+    if (this->wheel)
+        this->wheel->cancel(*this);
+}
+
+// The wheel sta::timer schedules in, in milliseconds
+inline timer_wheel& timers() {
+    static timer_wheel wheel(millis());
+    return wheel;
+}
+
+END_NP_BLOCK
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef _STA_TYPE_TRAITS_
+#define _STA_TYPE_TRAITS_
+
+#include "sta.h"
+
+BEGIN_NP_BLOCK
+
+/*
+Compile time type queries and transformations, a subset of <type_traits>.
+
+The AVR toolchain ships no C++ standard library, so the traits the library needs
+live here. Traits the language cannot express are answered by compiler builtins.
+
+Basic usage:
+	template <class T>
+	typename sta::enable_if<sta::is_trivially_copyable<T>::value>::type copy(T* to, const T* from, size_t n) {
+		memcpy(to, from, n * sizeof(T));
+	}
+*/
+
+// BASE
+
+template <class T, T v>
+struct _STAXXEXPORT integral_constant {
+	static constexpr T value = v;
+	typedef T value_type;
+	typedef integral_constant type;
+	constexpr operator value_type() const _STAXX_NOEXCEPT { return value; }
+};
+
+template <class T, T v>
+constexpr T integral_constant<T, v>::value;
+
+typedef integral_constant<bool, true> true_type;
+typedef integral_constant<bool, false> false_type;
+
+// SELECTION
+
+template <bool B, class T = void> struct enable_if {};
+template <class T> struct enable_if<true, T> { typedef T type; };
+
+template <bool B, class T, class F> struct conditional { typedef T type; };
+template <class T, class F> struct conditional<false, T, F> { typedef F type; };
+
+// TRANSFORMATIONS
+
+template <class T> struct remove_reference { typedef T type; };
+template <class T> struct remove_reference<T&> { typedef T type; };
+template <class T> struct remove_reference<T&&> { typedef T type; };
+
+template <class T> struct remove_const { typedef T type; };
+template <class T> struct remove_const<const T> { typedef T type; };
+
+template <class T> struct remove_volatile { typedef T type; };
+template <class T> struct remove_volatile<volatile T> { typedef T type; };
+
+template <class T> struct remove_cv {
+	typedef typename remove_volatile<typename remove_const<T>::type>::type type;
+};
+
+template <class T> struct remove_extent { typedef T type; };
+template <class T> struct remove_extent<T[]> { typedef T type; };
+template <class T, size_t N> struct remove_extent<T[N]> { typedef T type; };
+
+template <class T> struct add_pointer { typedef typename remove_reference<T>::type* type; };
+template <class T> struct add_lvalue_reference { typedef T& type; };
+template <> struct add_lvalue_reference<void> { typedef void type; };
+template <class T> struct add_rvalue_reference { typedef T&& type; };
+template <> struct add_rvalue_reference<void> { typedef void type; };
+
+// Only usable in unevaluated contexts such as decltype
+template <class T>
+typename add_rvalue_reference<T>::type declval() _STAXX_NOEXCEPT;
+
+// RELATIONS AND CATEGORIES
+
+template <class T, class U> struct is_same : false_type {};
+template <class T> struct is_same<T, T> : true_type {};
+
+template <class T> struct is_const : false_type {};
+template <class T> struct is_const<const T> : true_type {};
+
+template <class T> struct is_lvalue_reference : false_type {};
+template <class T> struct is_lvalue_reference<T&> : true_type {};
+
+template <class T> struct is_rvalue_reference : false_type {};
+template <class T> struct is_rvalue_reference<T&&> : true_type {};
+
+template <class T> struct is_reference
+	: integral_constant<bool, is_lvalue_reference<T>::value || is_rvalue_reference<T>::value> {};
+
+template <class T> struct is_array : false_type {};
+template <class T> struct is_array<T[]> : true_type {};
+template <class T, size_t N> struct is_array<T[N]> : true_type {};
+
+template <class T> struct _is_pointer : false_type {};
+template <class T> struct _is_pointer<T*> : true_type {};
+template <class T> struct is_pointer : _is_pointer<typename remove_cv<T>::type> {};
+
+// Functions are the only types that cannot be const qualified, apart from references
+template <class T> struct is_function
+	: integral_constant<bool, !is_const<const T>::value && !is_reference<T>::value> {};
+
+template <class T> struct _is_integral : false_type {};
+template <> struct _is_integral<bool> : true_type {};
+template <> struct _is_integral<char> : true_type {};
+template <> struct _is_integral<signed char> : true_type {};
+template <> struct _is_integral<unsigned char> : true_type {};
+template <> struct _is_integral<short> : true_type {};
+template <> struct _is_integral<unsigned short> : true_type {};
+template <> struct _is_integral<int> : true_type {};
+template <> struct _is_integral<unsigned int> : true_type {};
+template <> struct _is_integral<long> : true_type {};
+template <> struct _is_integral<unsigned long> : true_type {};
+template <> struct _is_integral<long long> : true_type {};
+template <> struct _is_integral<unsigned long long> : true_type {};
+template <class T> struct is_integral : _is_integral<typename remove_cv<T>::type> {};
+
+template <class Base, class Derived>
+struct is_base_of : integral_constant<bool, __is_base_of(Base, Derived)> {};
+
+template <class T> struct is_empty : integral_constant<bool, __is_empty(T)> {};
+template <class T> struct is_trivially_copyable : integral_constant<bool, __is_trivially_copyable(T)> {};
+template <class T> struct is_trivially_destructible : integral_constant<bool, __has_trivial_destructor(T)> {};
+
+// Type of a parameter passed by value: arrays and functions become pointers, cv is dropped
+template <class T>
+struct decay {
+private:
+	typedef typename remove_reference<T>::type U;
+public:
+	typedef typename conditional<is_array<U>::value,
+		typename remove_extent<U>::type*,
+		typename conditional<is_function<U>::value,
+			typename add_pointer<U>::type,
+			typename remove_cv<U>::type>::type>::type type;
+};
+
+END_NP_BLOCK
+
+#endif
@@ -1,31 +1,181 @@
-
 #ifndef _STA_ENTRY_POINT_
 #define _STA_ENTRY_POINT_
 
 #include "sta.h"
 #include "microcontroller.h"
 #include "./core/memory.h"
+#include "./core/timer_wheel.h"
+#include "./core/clock.h"
+#include "./core/idle.h"
+#include "./core/cycle.h"
+#include "./core/histogram.h"
+#include "log.h"
 
 BEGIN_NP_BLOCK
 extern sta::micro_controller* create_app();
 END_NP_BLOCK
 
+/*
+Define STA_SETUP_ARENA_SIZE (in bytes) before including sta++ to pack everything
+allocated by create_app() and onInit() into one static arena: the app object, its
+components, child lists and callbacks then cost no malloc header and cannot
+fragment the heap, and are only padded to the alignment their size allows. The arena is only active during setup(), afterwards new and
+delete use the heap again; objects that were allocated in the arena are never
+given back. The bytes setup consumed are logged once Serial is up.
+*/
+#ifdef STA_SETUP_ARENA_SIZE
+static sta::static_arena<STA_SETUP_ARENA_SIZE> setupArena;
+static bool setupArenaActive = false;
+static size_t setupArenaOverflow = 0;
+
+void* operator new(size_t size) {
+    if (setupArenaActive) {
+        // the alignment of a type divides its size, so the lowest set bit of the size is enough
+        size_t align = size & (~size + 1);
+        if (align == 0 || align > alignof(sta::max_align))
+            align = alignof(sta::max_align);
+        if (void* p = setupArena.allocate(size, align)) return p;
+        setupArenaOverflow += size;
+    }
+    void* p = malloc(size ? size : 1);
+    // new does not return nullptr, out of memory ends the program like the coroutine locals do
+    if (p == nullptr)
+        abort();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) _STAXX_NOEXCEPT {
+    if (setupArena.owns(p)) setupArena.deallocate(p);
+    else free(p);
+}
+
+void operator delete[](void* p) _STAXX_NOEXCEPT {
+    operator delete(p);
+}
+
+#if __cpp_sized_deallocation
+void operator delete(void* p, size_t) _STAXX_NOEXCEPT {
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) _STAXX_NOEXCEPT {
+    operator delete(p);
+}
+#endif
+#endif
+
+/*
+Define STA_LOOP_HISTOGRAM before including sta++ to keep a histogram of how long
+the loop iterations that call onUpdate() take, in microseconds, in log2 buckets
+(see histogram.h). Iterations longer than STA_LOOP_BUDGET_US count as overruns.
+sta::loop_histogram() gives the min, mean, p99 and max at any time, and every
+STA_LOOP_HISTOGRAM_DUMP_MS milliseconds they are logged, 0 turns that off.
+*/
+#ifdef STA_LOOP_HISTOGRAM
+#ifndef STA_LOOP_BUDGET_US
+#define STA_LOOP_BUDGET_US 10000
+#endif
+
+#ifndef STA_LOOP_HISTOGRAM_DUMP_MS
+#define STA_LOOP_HISTOGRAM_DUMP_MS 10000
+#endif
+
+BEGIN_NP_BLOCK
+inline log2_histogram<>& loop_histogram() {
+    static log2_histogram<> histogram(STA_LOOP_BUDGET_US);
+    return histogram;
+}
+END_NP_BLOCK
+
+static void recordLoop(uint32_t began) {
+    sta::loop_histogram().record((uint32_t) micros() - began);
+#if STA_LOOP_HISTOGRAM_DUMP_MS > 0
+    static sta::uint64 dumped = sta::loop_clock::now();
+    if (sta::loop_clock::now() - dumped >= STA_LOOP_HISTOGRAM_DUMP_MS)
+    {
+        dumped = sta::loop_clock::now();
+        sta::loop_histogram().dump(F("loop us"));
+    }
+#endif
+}
+#endif
+
 static sta::unique_ptr<sta::micro_controller> app;
 static bool breakLoop = false;
 
 void setup() {
+#ifdef STA_SETUP_ARENA_SIZE
+    setupArenaActive = true;
+#endif
     app.reset(sta::create_app());
     while(!app->onInit());
+#ifdef STA_SETUP_ARENA_SIZE
+    setupArenaActive = false;
+#endif
     sta::begin(9600);
+#ifdef STA_SETUP_ARENA_SIZE
+    sta::logs("setup arena:", setupArena.used(), "of", setupArena.capacity(), "bytes,", setupArenaOverflow, "bytes overflowed to the heap");
+#endif
+}
+
+/*
+When the app's idleMicros() says nothing is due for a while, loop() sleeps after
+onUpdate() until then, or until the next timer expires if that comes first. An
+app running on a fixed cycle (cycleMicros(), see cycle.h) sleeps until its next
+cycle instead. See idle.h for how the sleep works on every architecture and for
+its stats().
+*/
+static void loopIdle(unsigned long period) {
+    unsigned long us = period ? sta::loop_cycle::micros_left() : app->idleMicros();
+    // deferred logs drain from the loop, log_flush() falls back to blocking if they don't
+    if (us == 0 || sta::log_pending() != 0)
+        return;
+    uint32_t expiry;
+    if (sta::timers().next_expiry(expiry))
+    {
+        unsigned long timer = sta::loop_clock::micros_until(expiry);
+        if (timer < us)
+            us = timer;
+    }
+    sta::loop_idle::sleep(us);
 }
 
 void loop() {
     if (breakLoop) return;
-    if (!app->onUpdate()) 
-        breakLoop = true;
+#ifdef STA_LOOP_HISTOGRAM
+    uint32_t began = micros();
+#endif
+    // one timestamp for everything this iteration does
+    sta::timers().update((uint32_t) sta::loop_clock::tick());
+    sta::loop_idle::resumed();
+
+    unsigned long period = app->cycleMicros();
+    if (period == 0 || sta::loop_cycle::due())
+    {
+        if (period != 0)
+            sta::loop_cycle::begin();
+        if (!app->onUpdate())
+            breakLoop = true;
+        if (period != 0)
+            sta::loop_cycle::end(period);
+#ifdef STA_LOOP_HISTOGRAM
+        recordLoop(began);
+#endif
+    }
     
+    sta::log_flush();
     if (breakLoop)
+    {
         app->onEnd();
+        sta::log_drain();
+        Serial.flush();
+    }
+    else
+        loopIdle(period);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -25,7 +25,11 @@ public:
 public:
     virtual inline bool onInit() { return false; }
     virtual inline bool onUpdate() { return false; }
-    virtual inline void onEnd();
+    virtual inline void onEnd() {}
+    // Microseconds nothing is due after onUpdate(), the loop may sleep that long. 0 keeps it polling.
+    virtual inline unsigned long idleMicros() { return 0; }
+    // Period in microseconds to call onUpdate() at, see cycle.h. 0 (the default) calls it on every loop().
+    virtual inline unsigned long cycleMicros() { return 0; }
 };
 
 
@@ -2,6 +2,325 @@
 #define _STA_LOG_
 
 #include "sta.h"
+#include "./core/type_traits.h"
+
+/*
+Define STA_LOG_DEFERRED before including sta++ to keep sta::log and sta::logs off
+the serial port. A call then only packs its arguments into a binary record in a
+RAM ring of STA_LOG_BUFFER_SIZE bytes: numbers are stored as their raw bytes,
+strings are copied (at most STA_LOG_STRING_MAX characters) and on AVR an F()
+string costs just its flash address. log_flush() hands the records to Serial
+as far as availableForWrite() allows, so it never waits for the UART;
+entry_point.h calls it on every loop iteration. A record that does not fit in
+the ring is dropped, and the next one that fits is preceded by a count of the
+dropped ones. log_drain() writes out everything queued, waiting for the UART,
+entry_point.h calls it once the app ended.
+
+scripts/log_decode.py turns the captured serial stream back into text, given
+the firmware ELF to resolve the flash strings:
+
+    pio device monitor --raw | scripts/log_decode.py --elf .pio/build/nanoatmega328/firmware.elf
+
+Text printed on Serial by other code passes through the decoder unchanged.
+Records are meant to be written from the loop, not from interrupt handlers.
+On cores whose availableForWrite() always reports 0 (the Print default), once
+it reported no room for STA_LOG_STALL_MS log_flush() writes the queued records
+with a blocking write instead, so they still get out, just not in the
+background.
+*/
+#ifdef STA_LOG_DEFERRED
+
+#ifndef STA_LOG_BUFFER_SIZE
+#define STA_LOG_BUFFER_SIZE 128
+#endif
+
+#ifndef STA_LOG_STRING_MAX
+#define STA_LOG_STRING_MAX 32
+#endif
+
+// Longer than a full TX buffer takes to leave at 9600 baud
+#ifndef STA_LOG_STALL_MS
+#define STA_LOG_STALL_MS 100
+#endif
+
+BEGIN_NP_BLOCK
+
+/*
+Layout of a record, shared with scripts/log_decode.py:
+    Sync, payload length, payload (kind, arguments), xor of the payload
+Every argument starts with a tag, its type in the high nibble and its size in
+bytes in the low one. Numbers follow in little endian, a Text tag is followed by
+the length and the characters, a FlashText tag by the address of the string.
+*/
+struct _STAXXEXPORT log_record {
+    static constexpr byte Sync = 0xA5;
+
+    // Kinds: log() without separators, logs() with spaces, count of dropped records
+    static constexpr byte Plain = 0;
+    static constexpr byte Spaced = 1;
+    static constexpr byte Dropped = 2;
+
+    // Tags
+    static constexpr byte Unsupported = 0x00;
+    static constexpr byte Signed = 0x10;
+    static constexpr byte Unsigned = 0x20;
+    static constexpr byte Float = 0x30;
+    static constexpr byte Char = 0x41;
+    static constexpr byte Text = 0x50;
+    static constexpr byte FlashText = 0x70;
+};
+
+class _STAXXEXPORT deferred_log {
+public:
+    // Queues a record with the arguments, or drops it when the ring is full
+    template <typename... Args>
+    static void write(byte kind, const Args&... args) {
+        state& s = get();
+        size_t size = 1 + sizes(args...);
+        if (s.dropped != 0)
+        {
+            // tell how many went missing before anything else is logged
+            if (free() < DroppedSize + size + 3)
+            {
+                s.dropped++;
+                return;
+            }
+            unsigned long dropped = s.dropped;
+            s.dropped = 0;
+            begin(1 + argSize(dropped));
+            put(log_record::Dropped);
+            encode(dropped);
+            end();
+        }
+        if (size > 255 || free() < size + 3)
+        {
+            s.dropped++;
+            return;
+        }
+        begin(size);
+        put(kind);
+        encode(args...);
+        end();
+    }
+
+    // Sends as much as the serial port takes without blocking
+    static void flush() {
+        state& s = get();
+        if (s.count == 0)
+            return;
+        int room = Serial.availableForWrite();
+        if (room > 0)
+            s.stalled = false;
+        else if (!s.stalled)
+        {
+            s.stalled = true;
+            s.stallStart = millis();
+        }
+        else if ((uint32_t) millis() - s.stallStart >= STA_LOG_STALL_MS)
+        {
+            // the core may not report its room at all
+            s.stalled = false;
+            drain();
+            return;
+        }
+        while (room > 0 && s.count != 0)
+        {
+            size_t chunk = STA_LOG_BUFFER_SIZE - s.tail;
+            if (chunk > s.count)
+                chunk = s.count;
+            if (chunk > (size_t) room)
+                chunk = room;
+            Serial.write(s.buffer + s.tail, chunk);
+            s.tail = (s.tail + chunk) % STA_LOG_BUFFER_SIZE;
+            s.count -= chunk;
+            room -= chunk;
+        }
+    }
+
+    // Sends everything queued, waiting for the serial port
+    static void drain() {
+        state& s = get();
+        while (s.count != 0)
+        {
+            size_t chunk = STA_LOG_BUFFER_SIZE - s.tail;
+            if (chunk > s.count)
+                chunk = s.count;
+            Serial.write(s.buffer + s.tail, chunk);
+            s.tail = (s.tail + chunk) % STA_LOG_BUFFER_SIZE;
+            s.count -= chunk;
+        }
+    }
+
+    // Bytes waiting for the serial port
+    static size_t pending() { return get().count; }
+    // Records dropped since the last one that made it
+    static unsigned long dropped() { return get().dropped; }
+private:
+    // Bytes of the record telling the number of dropped records
+    static constexpr size_t DroppedSize = 3 + 1 + 1 + sizeof(unsigned long);
+
+    struct state {
+        byte buffer[STA_LOG_BUFFER_SIZE];
+        size_t head, tail, count;
+        unsigned long dropped;
+        byte checksum;
+        // Since when availableForWrite() reports no room
+        bool stalled;
+        uint32_t stallStart;
+    };
+
+    static state& get() {
+        static state s;
+        return s;
+    }
+
+    static size_t free() { return STA_LOG_BUFFER_SIZE - get().count; }
+
+    static void put(byte b) {
+        state& s = get();
+        s.buffer[s.head] = b;
+        s.head = (s.head + 1) % STA_LOG_BUFFER_SIZE;
+        s.count++;
+        s.checksum ^= b;
+    }
+
+    static void put(const void* data, size_t size) {
+        const byte* bytes = static_cast<const byte*>(data);
+        for (size_t i = 0; i < size; i++)
+            put(bytes[i]);
+    }
+
+    static void begin(size_t size) {
+        put(log_record::Sync);
+        put((byte) size);
+        get().checksum = 0;
+    }
+
+    static void end() {
+        put(get().checksum);
+    }
+
+    static size_t textSize(const char* text) {
+        size_t n = text ? strlen(text) : 0;
+        return n > STA_LOG_STRING_MAX ? STA_LOG_STRING_MAX : n;
+    }
+
+    static void putText(const char* text, size_t n) {
+        put(log_record::Text);
+        put((byte) n);
+        put(text, n);
+    }
+
+    static size_t sizes() { return 0; }
+
+    template <typename T, typename... Rest>
+    static size_t sizes(const T& first, const Rest&... rest) {
+        return argSize(first) + sizes(rest...);
+    }
+
+    static void encode() {}
+
+    template <typename T, typename... Rest>
+    static void encode(const T& first, const Rest&... rest) {
+        encodeArg(first);
+        encode(rest...);
+    }
+
+    // ARGUMENTS, sizes and encodings per type
+
+    // Numbers, in the byte order of the board which is little endian on all of them
+    template <typename T>
+    static size_t argSize(const T&, true_type) { return 1 + sizeof(T); }
+    template <typename T>
+    static void encodeArg(const T& value, true_type) {
+        put((T(-1) < T(0) ? log_record::Signed : log_record::Unsigned) | sizeof(T));
+        put(&value, sizeof(T));
+    }
+
+    // Anything else shows up as a placeholder
+    template <typename T>
+    static size_t argSize(const T&, false_type) { return 1; }
+    template <typename T>
+    static void encodeArg(const T&, false_type) { put(log_record::Unsupported); }
+
+    template <typename T>
+    static size_t argSize(const T& value) { return argSize(value, is_integral<T>()); }
+    template <typename T>
+    static void encodeArg(const T& value) { encodeArg(value, is_integral<T>()); }
+
+    static size_t argSize(char) { return 2; }
+    static void encodeArg(char c) {
+        put(log_record::Char);
+        put((byte) c);
+    }
+
+    static size_t argSize(float) { return 1 + sizeof(float); }
+    static void encodeArg(float value) {
+        put(log_record::Float | sizeof(float));
+        put(&value, sizeof(float));
+    }
+
+    static size_t argSize(double) { return 1 + sizeof(double); }
+    static void encodeArg(double value) {
+        put(log_record::Float | sizeof(double));
+        put(&value, sizeof(double));
+    }
+
+    static size_t argSize(const char* text) { return 2 + textSize(text); }
+    static void encodeArg(const char* text) { putText(text, textSize(text)); }
+    static size_t argSize(char* text) { return argSize((const char*) text); }
+    static void encodeArg(char* text) { encodeArg((const char*) text); }
+
+    static size_t argSize(const String& text) { return argSize(text.c_str()); }
+    static void encodeArg(const String& text) { encodeArg(text.c_str()); }
+
+#if defined(__AVR__)
+    // Strings in flash are found again in the ELF by their address
+    static size_t argSize(const __FlashStringHelper*) { return 1 + sizeof(void*); }
+    static void encodeArg(const __FlashStringHelper* text) {
+        put(log_record::FlashText | sizeof(void*));
+        put(&text, sizeof(void*));
+    }
+#else
+    static size_t argSize(const __FlashStringHelper* text) { return argSize(reinterpret_cast<const char*>(text)); }
+    static void encodeArg(const __FlashStringHelper* text) { encodeArg(reinterpret_cast<const char*>(text)); }
+#endif
+};
+
+/*
+    Logs objects to the arduino console.
+*/
+template <typename... Args>
+void log(Args... args) _STAXX_NOEXCEPT {
+    deferred_log::write(log_record::Plain, args...);
+}
+
+/*
+    Logs objects to the arduino console, separated by spaces.
+*/
+template <typename... Args>
+void logs(Args... args) _STAXX_NOEXCEPT {
+    deferred_log::write(log_record::Spaced, args...);
+}
+
+// Sends queued log records as far as the serial port takes them without blocking
+inline void log_flush() {
+    deferred_log::flush();
+}
+
+// Sends all queued log records, waiting for the serial port
+inline void log_drain() {
+    deferred_log::drain();
+}
+
+// Bytes of log records waiting for the serial port
+inline size_t log_pending() {
+    return deferred_log::pending();
+}
+
+END_NP_BLOCK
+
+#else
 
 BEGIN_NP_BLOCK
 
@@ -42,6 +361,17 @@ void logs(T t, Args... args) _STAXX_NOEXCEPT {
     logs(args...);
 }
 
+// Logs are written right away, there is nothing to flush
+inline void log_flush() {}
+
+inline void log_drain() {}
+
+inline size_t log_pending() {
+    return 0;
+}
+
 END_NP_BLOCK
 
-#endif
\ No newline at end of file
+#endif
+
+#endif
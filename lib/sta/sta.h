@@ -11,6 +11,7 @@
 #define ARCH_NRF52			0x000F
 #define ARCH_MEGAAVR		0x001F
 #define ARCH_MBED			0x003F
+#define ARCH_HOST			0x007F
 
 #if defined(ARDUINO_ARCH_AVR)
 # define ARDUINO_ARCH ARCH_AVR
@@ -26,6 +27,8 @@
 # define ARDUINO_ARCH ARCH_MEGAAVR
 #elif defined(ARDUINO_ARCH_MBED)
 # define ARDUINO_ARCH ARCH_MBED
+#elif defined(ARDUINO_ARCH_HOST)
+# define ARDUINO_ARCH ARCH_HOST
 #else
 #error "This library only supports boards with an AVR, SAM, SAMD, NRF52 or STM32F4 processor."
 #endif
@@ -4,6 +4,8 @@
 #pragma GCC visibility push(default)
 
 #include "sta.h"
+#include "./core/type_traits.h"
+#include "./core/clock.h"
 
 BEGIN_NP_BLOCK
 
@@ -23,6 +25,8 @@ public:
 /*
 A class that can be used to generate a delay in the without using the delay() function.
 Can be used symbiotically with your entire program.
+A point defaults to the time of the current loop iteration (see sta::loop_clock),
+which counts in 64 bits, so differences stay right when millis() wraps around.
 
 Basic usage:
 sta::safe_delay_point previous = 0UL;
@@ -36,7 +40,7 @@ if (current - previous > interval) {
 */
 class _STAXXEXPORT safe_delay_point {
 public: // CON-/DESTRUCTORS
-	inline safe_delay_point(uint64 point=millis()) 
+	inline safe_delay_point(uint64 point=loop_clock::now()) 
 		: _tp(point)
 	{}
 public: // OPERATORS
@@ -65,7 +69,7 @@ Sets the stating baud rate of each cycle.
 inline _STAXXEXPORT 
 void begin(uint32 baudrate) 
 _STAXX_USE_NOEXCEPT {
-#if defined(UBRRH) || defined(UBRR0H)
+#if defined(UBRRH) || defined(UBRR0H) || defined(ARDUINO_ARCH_HOST)
 	Serial.begin(baudrate);
 #endif
 #if defined(UBRR1H)
@@ -82,7 +86,7 @@ _STAXX_USE_NOEXCEPT {
 inline _STAXXEXPORT 
 void end() 
 _STAXX_USE_NOEXCEPT {
-#if defined(UBRRH) || defined(UBRR0H)
+#if defined(UBRRH) || defined(UBRR0H) || defined(ARDUINO_ARCH_HOST)
 	Serial.end();
 #endif
 #if defined(UBRR1H)
@@ -96,6 +100,31 @@ _STAXX_USE_NOEXCEPT {
 #endif
 }
 
+// Casts to an rvalue, so the object can be moved from
+template <class T>
+constexpr typename remove_reference<T>::type&& move(T&& t) _STAXX_NOEXCEPT {
+	return static_cast<typename remove_reference<T>::type&&>(t);
+}
+
+// Passes an argument on with the value category it was given
+template <class T>
+constexpr T&& forward(typename remove_reference<T>::type& t) _STAXX_NOEXCEPT {
+	return static_cast<T&&>(t);
+}
+
+template <class T>
+constexpr T&& forward(typename remove_reference<T>::type&& t) _STAXX_NOEXCEPT {
+	static_assert(!is_lvalue_reference<T>::value, "cannot forward an rvalue as an lvalue");
+	return static_cast<T&&>(t);
+}
+
+template <class T>
+inline void swap(T& a, T& b) {
+	T tmp(sta::move(a));
+	a = sta::move(b);
+	b = sta::move(tmp);
+}
+
 namespace rel_ops {
 	template<class T> inline bool operator!=(const T& x, const T& y) {
 		return !(x == y);
@@ -125,7 +154,9 @@ public:
 public:
 	pair() = default;
 	pair(const T1& x, const T2& y) : first(x), second(y) {  }
+	template<class U, class V> pair(U&& x, V&& y) : first(sta::forward<U>(x)), second(sta::forward<V>(y)) {  }
 	template<class U, class V> pair(const pair<U, V>& p) : first(p.first), second(p.second) { }
+	template<class U, class V> pair(pair<U, V>&& p) : first(sta::move(p.first)), second(sta::move(p.second)) { }
 };
 
 template <class T1, class T2> 
@@ -159,15 +190,9 @@ bool operator<=(const pair<T1, T2>& x, const pair<T1, T2>& y) {
 	return !(y < x);
 }
 
-template <class T1, class T2> pair<T1, T2> 
-make_pair(const T1& x, const T2& y) {
-	return pair<T1, T2>(x, y);
-}
-
-// Stubb out move for compatibility
-template<class T>
-inline T& move(T& t) _STAXX_NOEXCEPT {
-	return t;
+template <class T1, class T2> pair<typename decay<T1>::type, typename decay<T2>::type> 
+make_pair(T1&& x, T2&& y) {
+	return pair<typename decay<T1>::type, typename decay<T2>::type>(sta::forward<T1>(x), sta::forward<T2>(y));
 }
 
 END_NP_BLOCK
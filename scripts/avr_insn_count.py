@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Static instruction and size counts of the sta benchmark kernels in an AVR firmware.
+
+Disassembles the ELF built by env:bench_nanoatmega328 and reports, for every
+bench_* symbol, the number of instructions and the flash bytes it occupies,
+followed by the avr-size summary of the whole image.
+
+    pio run -e bench_nanoatmega328
+    scripts/avr_insn_count.py .pio/build/bench_nanoatmega328/firmware.elf
+    scripts/avr_insn_count.py firmware.elf --json baseline.json        # record
+    scripts/avr_insn_count.py firmware.elf --baseline baseline.json    # compare
+
+With --baseline the script exits with status 1 when a kernel grew by more than
+--tolerance percent instructions, so it can gate a CI job.
+"""
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+SYMBOL = re.compile(r"^[0-9a-f]+ <(?P<name>[^>]+)>:$")
+INSN = re.compile(r"^\s+[0-9a-f]+:\s+(?P<bytes>(?:[0-9a-f]{2} )+)\s*(?P<mnemonic>\S+)")
+
+
+def find_tool(name, explicit):
+    if explicit:
+        return explicit
+    found = shutil.which(name)
+    if found:
+        return found
+    # PlatformIO keeps its toolchain out of PATH
+    pio = os.path.expanduser("~/.platformio/packages/toolchain-atmelavr/bin/" + name)
+    if os.path.exists(pio):
+        return pio
+    sys.exit("error: %s not found, pass it with --%s" % (name, name.split("-")[1]))
+
+
+def count_kernels(elf, objdump, prefix):
+    out = subprocess.run([objdump, "-d", elf], check=True, capture_output=True, text=True).stdout
+    kernels = {}
+    current = None
+    for line in out.splitlines():
+        m = SYMBOL.match(line)
+        if m:
+            name = m.group("name")
+            current = name if name.startswith(prefix) else None
+            if current:
+                kernels[current] = {"instructions": 0, "bytes": 0}
+            continue
+        if current:
+            m = INSN.match(line)
+            if m:
+                kernels[current]["instructions"] += 1
+                kernels[current]["bytes"] += len(m.group("bytes").split())
+    return kernels
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf")
+    parser.add_argument("--objdump", help="path to avr-objdump")
+    parser.add_argument("--size", help="path to avr-size")
+    parser.add_argument("--prefix", default="bench_", help="symbol prefix of the kernels")
+    parser.add_argument("--json", help="write the counts to this file")
+    parser.add_argument("--baseline", help="compare against counts written earlier with --json")
+    parser.add_argument("--tolerance", type=float, default=0.0, help="allowed growth in percent")
+    args = parser.parse_args()
+
+    kernels = count_kernels(args.elf, find_tool("avr-objdump", args.objdump), args.prefix)
+    if not kernels:
+        sys.exit("error: no %s* symbols in %s" % (args.prefix, args.elf))
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    regressions = []
+    print("%-28s %8s %8s %10s" % ("kernel", "insns", "bytes", "delta"))
+    for name in sorted(kernels):
+        k = kernels[name]
+        delta = ""
+        if name in baseline:
+            before = baseline[name]["instructions"]
+            diff = k["instructions"] - before
+            delta = "%+d" % diff
+            if before and diff * 100.0 / before > args.tolerance:
+                regressions.append(name)
+        print("%-28s %8d %8d %10s" % (name, k["instructions"], k["bytes"], delta))
+
+    print()
+    subprocess.run([find_tool("avr-size", args.size), args.elf], check=True)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(kernels, f, indent=2, sort_keys=True)
+
+    if regressions:
+        print("\ninstruction count regressions: " + ", ".join(regressions), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Decoder of the deferred sta::log records (STA_LOG_DEFERRED, see lib/sta/log.h).
+
+Reads the raw serial stream of the board, turns every log record back into the
+line sta::log or sta::logs would have printed, and passes any other text through
+unchanged. On AVR, F() strings are logged by their flash address; --elf gives
+the firmware they are read from.
+
+    pio device monitor --raw | scripts/log_decode.py --elf .pio/build/nanoatmega328/firmware.elf
+    scripts/log_decode.py capture.bin --elf firmware.elf
+
+Records that fail their checksum are passed through as raw bytes.
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = 0xA5
+
+PLAIN, SPACED, DROPPED = 0, 1, 2
+
+UNSUPPORTED, SIGNED, UNSIGNED, FLOAT, CHAR, TEXT, FLASH_TEXT = 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x7
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+class Elf:
+    """Just enough of an ELF reader to look strings up by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF":
+            sys.exit("error: %s is not an ELF file" % path)
+        wide = self.data[4] == 2
+        endian = "<" if self.data[5] == 1 else ">"
+        if wide:
+            shoff, = struct.unpack_from(endian + "Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 0x3A)
+            layout = endian + "IIQQQQ"
+        else:
+            shoff, = struct.unpack_from(endian + "I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 0x2E)
+            layout = endian + "IIIIII"
+        self.sections = []
+        for i in range(shnum):
+            _, kind, flags, addr, offset, size = struct.unpack_from(layout, self.data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and kind != SHT_NOBITS:
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.find(b"\0", start, offset + size)
+                return self.data[start:end if end >= 0 else offset + size].decode("latin-1")
+        return None
+
+
+def decode_args(payload, elf):
+    """Values of the arguments in a record payload, as the Arduino core prints them."""
+    values = []
+    i = 0
+    while i < len(payload):
+        tag = payload[i]
+        kind, size = tag >> 4, tag & 0xF
+        i += 1
+        if kind == UNSUPPORTED:
+            values.append("?")
+        elif kind in (SIGNED, UNSIGNED):
+            values.append(str(int.from_bytes(payload[i:i + size], "little", signed=kind == SIGNED)))
+            i += size
+        elif kind == FLOAT:
+            value, = struct.unpack_from("<f" if size == 4 else "<d", payload, i)
+            values.append("%.2f" % value)
+            i += size
+        elif kind == CHAR:
+            values.append(chr(payload[i]))
+            i += 1
+        elif kind == TEXT:
+            length = payload[i]
+            values.append(payload[i + 1:i + 1 + length].decode("latin-1"))
+            i += 1 + length
+        elif kind == FLASH_TEXT:
+            address = int.from_bytes(payload[i:i + size], "little")
+            text = elf.string(address) if elf else None
+            values.append(text if text is not None else "<flash 0x%04x>" % address)
+            i += size
+        else:
+            raise ValueError("unknown tag 0x%02x" % tag)
+    return values
+
+
+def decode_record(payload, elf):
+    kind, values = payload[0], decode_args(payload[1:], elf)
+    if kind == PLAIN:
+        return "".join(values)
+    if kind == SPACED:
+        return " ".join(values)
+    if kind == DROPPED:
+        return "[%s log records dropped]" % values[0]
+    raise ValueError("unknown record kind %d" % kind)
+
+
+class Decoder:
+    def __init__(self, out, elf):
+        self.out = out
+        self.elf = elf
+        self.pending = bytearray()
+
+    def feed(self, data):
+        self.pending += data
+        buf = self.pending
+        i = 0
+        while i < len(buf):
+            if buf[i] != SYNC:
+                end = buf.find(bytes([SYNC]), i)
+                end = len(buf) if end < 0 else end
+                self.out.write(buf[i:end].decode("latin-1"))
+                i = end
+                continue
+            if i + 2 > len(buf):
+                break
+            length = buf[i + 1]
+            if i + 3 + length > len(buf):
+                break
+            payload = bytes(buf[i + 2:i + 2 + length])
+            checksum = 0
+            for b in payload:
+                checksum ^= b
+            line = None
+            if length and checksum == buf[i + 2 + length]:
+                try:
+                    line = decode_record(payload, self.elf)
+                except (ValueError, IndexError, struct.error):
+                    line = None
+            if line is None:
+                # not a record after all
+                self.out.write(chr(buf[i]))
+                i += 1
+                continue
+            self.out.write(line + "\n")
+            i += 3 + length
+        del buf[:i]
+        self.out.flush()
+
+    def finish(self):
+        self.out.write(self.pending.decode("latin-1"))
+        self.pending.clear()
+        self.out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", default="-", help="captured stream, - for stdin")
+    parser.add_argument("--elf", help="firmware the F() strings are read from")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf) if args.elf else None
+    source = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    decoder = Decoder(sys.stdout, elf)
+    try:
+        while True:
+            chunk = source.read1(4096) if hasattr(source, "read1") else source.read(4096)
+            if not chunk:
+                break
+            decoder.feed(chunk)
+    except KeyboardInterrupt:
+        pass
+    decoder.finish()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -23,16 +23,14 @@ public:
   }
 
   bool onUpdate() override {
-    sta::safe_delay_point current;
-    if (sta::delta(current, previous) > 1000) {
-      this->updateDisplay(counterVar, 1);
-
-      this->previous = current;
-    }
+    this->updateDisplay(counterVar, 1);
 
     return true;
   }
 
+  // onUpdate() runs once a second
+  unsigned long cycleMicros() override { return 1000000UL; }
+
 private:
   void updateDisplay(int& counter, int delayTime) {
     this->disp.setComponentText("t0", String(counter));
@@ -44,7 +42,6 @@ private:
   sta::nextion_serial disp;
 
   int counterVar = 0;
-  unsigned long long previous = 0_sdp;
 };
 
 sta::micro_controller* sta::create_app() {
@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include <arduino_host.h>
+#include <unity.h>
+#include <sta++>
+
+/*
+Run order and deadline accounting of sta::coroutines<N>.
+
+The ordering tests drive a manager by hand. The deadline test runs it inside the
+framework's loop(), where coroutine_clock() holds still for a whole iteration.
+*/
+
+using namespace sta;
+
+static String order;
+
+static void recordA(COROUTINE_CONTEXT(coroutine)) {
+    BEGIN_COROUTINE;
+    order += 'a';
+    coroutine.wait(10);
+    COROUTINE_YIELD;
+    coroutine.loop();
+    END_COROUTINE;
+}
+
+static void recordB(COROUTINE_CONTEXT(coroutine)) {
+    BEGIN_COROUTINE;
+    order += 'b';
+    coroutine.wait(10);
+    COROUTINE_YIELD;
+    coroutine.loop();
+    END_COROUTINE;
+}
+
+static void recordC(COROUTINE_CONTEXT(coroutine)) {
+    BEGIN_COROUTINE;
+    order += 'c';
+    coroutine.wait(10);
+    COROUTINE_YIELD;
+    coroutine.loop();
+    END_COROUTINE;
+}
+
+// Runs 20ms on every turn, far past its 5ms deadline
+static void overlong(COROUTINE_CONTEXT(coroutine)) {
+    BEGIN_COROUTINE;
+    delay(20);
+    coroutine.wait(10);
+    COROUTINE_YIELD;
+    coroutine.loop();
+    END_COROUTINE;
+}
+
+static coroutines<2> appCoroutines;
+
+class test_app : public micro_controller {
+public:
+    bool onInit() override {
+        appCoroutines.start(overlong).setDeadline(5);
+        return true;
+    }
+
+    bool onUpdate() override {
+        appCoroutines.update();
+        return true;
+    }
+};
+
+micro_controller* sta::create_app() {
+    return new test_app();
+}
+
+void setUp() {
+    order = "";
+}
+
+void tearDown() {}
+
+static void test_slot_order_without_priorities() {
+    coroutines<4> manager;
+    manager.start(recordA);
+    manager.start(recordB);
+    manager.start(recordC);
+    manager.update();
+    TEST_ASSERT_EQUAL_STRING("abc", order.c_str());
+}
+
+static void test_higher_priority_runs_first() {
+    coroutines<4> manager;
+    manager.start(recordA);
+    manager.start(recordB).setPriority(1);
+    manager.start(recordC).setPriority(2);
+    manager.update();
+    TEST_ASSERT_EQUAL_STRING("cba", order.c_str());
+}
+
+static void test_earliest_deadline_runs_first() {
+    coroutines<4> manager;
+    manager.set_policy(coroutine_policy::EarliestDeadline);
+    manager.start(recordA).setDeadline(5);
+    // without a deadline, after all those with one, whatever its priority
+    manager.start(recordB).setPriority(3);
+    manager.start(recordC).setDeadline(2);
+    manager.update();
+    TEST_ASSERT_EQUAL_STRING("cab", order.c_str());
+}
+
+static void test_overlong_run_misses_deadline_in_framework_loop() {
+    setup();
+    for (int i = 0; i < 5; i++)
+    {
+        loop();
+        arduino_host::advance_us(10);
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, appCoroutines.deadline_misses());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_slot_order_without_priorities);
+    RUN_TEST(test_higher_priority_runs_first);
+    RUN_TEST(test_earliest_deadline_runs_first);
+    RUN_TEST(test_overlong_run_misses_deadline_in_framework_loop);
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+#include <Arduino.h>
+#include <arduino_host.h>
+#include <unity.h>
+#include <sta++>
+
+/*
+The C++20 task backend of sta::coroutines<N>, only built by the native_test_tasks
+env since it needs -std=gnu++20.
+*/
+
+using namespace sta;
+
+micro_controller* sta::create_app() {
+    return NULL;
+}
+
+static String trace;
+static int destroyed;
+
+struct guard {
+    ~guard() { destroyed++; }
+};
+
+static void run(coroutines<4>& manager, int ms) {
+    for (int i = 0; i < ms; i++)
+    {
+        manager.update();
+        arduino_host::advance_ms(1);
+    }
+}
+
+void setUp() {
+    trace = "";
+    destroyed = 0;
+}
+
+void tearDown() {
+    TEST_ASSERT_EQUAL_UINT32(0, task_frames.stats().in_use);
+}
+
+static task<int> leaf(int x) {
+    co_await sleep_for(0);
+    co_return x * 2;
+}
+
+static task<int> middle(int x) {
+    int a = co_await leaf(x);
+    int b = co_await leaf(a);
+    co_return a + b;
+}
+
+static task<> root() {
+    int value = co_await middle(5);
+    trace += value;
+}
+
+static void test_nested_await_returns_values() {
+    coroutines<4> manager;
+    coroutine_impl& slot = manager.start(root());
+    run(manager, 5);
+    TEST_ASSERT_EQUAL_STRING("30", trace.c_str());
+    TEST_ASSERT_TRUE(slot.isTerminated());
+}
+
+static task<> sleeper() {
+    uint32_t started = millis();
+    co_await sleep_for(20);
+    trace += (uint32_t) millis() - started;
+}
+
+static void test_sleep_for_waits_through_update() {
+    coroutines<4> manager;
+    manager.start(sleeper());
+    run(manager, 19);
+    TEST_ASSERT_EQUAL_STRING("", trace.c_str());
+    run(manager, 2);
+    TEST_ASSERT_EQUAL_STRING("20", trace.c_str());
+}
+
+static task<> forever() {
+    guard g;
+    for (;;)
+        co_await sleep_for(10);
+}
+
+static task<> awaitsForever() {
+    guard g;
+    co_await forever();
+}
+
+static void test_terminate_frees_suspended_chain() {
+    coroutines<4> manager;
+    coroutine_impl& slot = manager.start(awaitsForever());
+    run(manager, 15);
+    TEST_ASSERT_EQUAL_UINT32(2, task_frames.stats().in_use);
+    slot.terminate();
+    run(manager, 1);
+    TEST_ASSERT_TRUE(slot.isTerminated());
+    TEST_ASSERT_EQUAL(2, destroyed);
+    TEST_ASSERT_EQUAL_UINT32(0, task_frames.stats().in_use);
+}
+
+static void test_exhausted_pool_gives_empty_task() {
+    task<> held[STA_TASK_FRAME_COUNT];
+    for (size_t i = 0; i < STA_TASK_FRAME_COUNT; i++)
+    {
+        held[i] = forever();
+        TEST_ASSERT_TRUE((bool) held[i]);
+    }
+    task<> extra = forever();
+    TEST_ASSERT_FALSE((bool) extra);
+
+    coroutines<4> manager;
+    coroutine_impl& slot = manager.start(sta::move(extra));
+    run(manager, 1);
+    TEST_ASSERT_TRUE(slot.isTerminated());
+
+    for (size_t i = 0; i < STA_TASK_FRAME_COUNT; i++)
+        held[i] = task<>();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_nested_await_returns_values);
+    RUN_TEST(test_sleep_for_waits_through_update);
+    RUN_TEST(test_terminate_frees_suspended_chain);
+    RUN_TEST(test_exhausted_pool_gives_empty_task);
+    return UNITY_END();
+}
@@ -0,0 +1,81 @@
+#include <Arduino.h>
+#include <arduino_host.h>
+#include <unity.h>
+#include <sta++>
+
+/*
+Deadlines of sta::timer_wheel that have already passed when they are scheduled.
+*/
+
+using namespace sta;
+
+micro_controller* sta::create_app() {
+    return NULL;
+}
+
+static int fired;
+
+static void count(void*) {
+    fired++;
+}
+
+void setUp() {
+    fired = 0;
+}
+
+void tearDown() {}
+
+static void test_deadline_at_last_update_fires_on_same_time() {
+    timer_wheel wheel(100);
+    timer_entry entry(&count);
+    wheel.update(100);
+    wheel.schedule(entry, 100);
+
+    uint32_t deadline = 0;
+    TEST_ASSERT_TRUE(wheel.next_expiry(deadline));
+    TEST_ASSERT_EQUAL_UINT32(100, deadline);
+    wheel.update(100);
+    TEST_ASSERT_EQUAL(1, fired);
+    TEST_ASSERT_FALSE(entry.isScheduled());
+}
+
+static void test_deadline_before_last_update_fires_once() {
+    timer_wheel wheel(100);
+    timer_entry entry(&count);
+    wheel.update(150);
+    wheel.schedule(entry, 120);
+    wheel.update(150);
+    wheel.update(151);
+    TEST_ASSERT_EQUAL(1, fired);
+}
+
+static timer_wheel* rearmed;
+static timer_entry* again;
+
+// Schedules itself for now on every call, as setTimeout(cb, 0) from a callback does
+static void rearm(void*) {
+    fired++;
+    rearmed->schedule(*again, rearmed->now());
+}
+
+static void test_deadline_scheduled_by_callback_waits_for_next_update() {
+    timer_wheel wheel(0);
+    timer_entry entry(&rearm);
+    rearmed = &wheel;
+    again = &entry;
+    wheel.schedule(entry, 10);
+    wheel.update(10);
+    TEST_ASSERT_EQUAL(1, fired);
+    wheel.update(10);
+    TEST_ASSERT_EQUAL(2, fired);
+    entry.cancel();
+    TEST_ASSERT_TRUE(wheel.empty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_deadline_at_last_update_fires_on_same_time);
+    RUN_TEST(test_deadline_before_last_update_fires_once);
+    RUN_TEST(test_deadline_scheduled_by_callback_waits_for_next_update);
+    return UNITY_END();
+}